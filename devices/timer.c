@@ -7,6 +7,7 @@
 #include "threads/io.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #include "threads/fixed-point.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
@@ -21,6 +22,24 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* If false (default), the timer interrupts TIMER_FREQ times per
+   second.  If true, the idle thread stops the periodic tick and
+   arms a one-shot interrupt for the next sleep deadline.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* 8254 input frequency divided by TIMER_FREQ, rounded to
+   nearest: the PIT count of one tick. */
+#define PIT_TICK ((1193180 + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Most ticks that one 16-bit one-shot count can span. */
+#define PIT_MAX_TICKS (0xffff / PIT_TICK)
+
+/* While a one-shot is armed, the ticks and the PIT count it
+   covers; oneshot_ticks is 0 otherwise. */
+static int64_t oneshot_ticks;
+static unsigned oneshot_count;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
@@ -29,19 +48,15 @@ static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
+static void pit_program (uint8_t mode, unsigned count);
+static unsigned pit_read (void);
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
    interrupt PIT_FREQ times per second, and registers the
    corresponding interrupt. */
 void
 timer_init (void) {
-	/* 8254 input frequency divided by TIMER_FREQ, rounded to
-	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
-
-	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb (0x40, count & 0xff);
-	outb (0x40, count >> 8);
+	pit_program (0x34, PIT_TICK);    /* Mode 2, rate generator. */
 
 	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
@@ -132,7 +147,15 @@ timer_print_stats (void) {
  sleep queue and call wake up function*/
 static void
 timer_interrupt(struct intr_frame *args UNUSED) {
-    ticks++;
+	if (oneshot_ticks > 0) {
+		/* The one-shot ran out: account for the ticks it stood in
+		   for and go back to the periodic tick. */
+		ticks += oneshot_ticks;
+		thread_add_idle_ticks (oneshot_ticks - 1);
+		oneshot_ticks = 0;
+		pit_program (0x34, PIT_TICK);
+	} else
+		ticks++;
     thread_tick(); // 현재 실행 중인 프로세스의 CPU 사용 시간을 업데이트
 
 	/* code to add:
@@ -146,14 +169,104 @@ timer_interrupt(struct intr_frame *args UNUSED) {
 		if (timer_ticks() % TIMER_FREQ == 0)//1초마다
 			{
 				calculate_load_avg();
-				recalculate_recent_cpu();
+				decay_recent_cpu();
 			}
-		if (timer_ticks() % 4 == 0) //4틱마다
-		 	recalculate_priority();
+		if (timer_ticks() % 4 == 0) //4틱마다, 실행 중인 스레드만 재계산
+		 	calculate_priority(thread_current());
 	}
 	thread_wakeup(ticks); 
+	workqueue_timer (ticks);
 }
 	
+/* Called by the idle thread, with interrupts off, just before it
+   halts.  In tickless mode, replaces the periodic tick by a single
+   interrupt at the next sleep or delayed work deadline, as far as
+   the PIT can count.  Under the MLFQS the one-shot stops at the
+   next multiple of 4 ticks and of TIMER_FREQ, where
+   timer_interrupt() has bookkeeping to do. */
+void
+timer_idle_enter (void) {
+	int64_t n;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!timer_tickless || oneshot_ticks > 0)
+		return;
+	n = thread_next_wakeup ();
+	if (workqueue_next_timer () < n)
+		n = workqueue_next_timer ();
+	n -= ticks;
+	if (n > PIT_MAX_TICKS)
+		n = PIT_MAX_TICKS;
+	if (thread_mlfqs) {
+		if (n > 4 - ticks % 4)
+			n = 4 - ticks % 4;
+		if (n > TIMER_FREQ - ticks % TIMER_FREQ)
+			n = TIMER_FREQ - ticks % TIMER_FREQ;
+	}
+	if (n < 2)
+		return;
+
+	/* Keep the phase of the tick: the one-shot first runs out the
+	   current period, then N - 1 more. */
+	oneshot_ticks = n;
+	oneshot_count = pit_read () + (n - 1) * PIT_TICK;
+	pit_program (0x30, oneshot_count);    /* Mode 0, one-shot. */
+}
+
+/* Called by the idle thread, with interrupts off, when it wakes
+   up.  If an interrupt other than the timer's ended the idle
+   period, credits the ticks that passed and restarts the periodic
+   tick.  Up to one tick's worth of phase is lost. */
+void
+timer_idle_exit (void) {
+	int64_t elapsed;
+	unsigned first;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (oneshot_ticks == 0)
+		return;
+
+	outb (0x43, 0xe2);    /* Read-back: status of counter 0. */
+	if (inb (0x40) & 0x80) {
+		/* OUT is high: the one-shot ran out and its interrupt is
+		   pending, which will add the last tick. */
+		elapsed = oneshot_ticks - 1;
+	} else {
+		unsigned passed = oneshot_count - pit_read ();
+
+		first = oneshot_count - (oneshot_ticks - 1) * PIT_TICK;
+		elapsed = passed < first ? 0 : 1 + (passed - first) / PIT_TICK;
+	}
+	ticks += elapsed;
+	thread_add_idle_ticks (elapsed);
+	oneshot_ticks = 0;
+	pit_program (0x34, PIT_TICK);
+}
+
+/* Loads COUNT into PIT counter 0 in MODE, given as the control
+   word for counter 0, LSB then MSB, binary. */
+static void
+pit_program (uint8_t mode, unsigned count) {
+	ASSERT (count > 0 && count <= 0xffff);
+
+	outb (0x43, mode);
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
+}
+
+/* Returns the current count of PIT counter 0. */
+static unsigned
+pit_read (void) {
+	unsigned lo, hi;
+
+	outb (0x43, 0x00);    /* CW: latch counter 0. */
+	lo = inb (0x40);
+	hi = inb (0x40);
+	return lo | (hi << 8);
+}
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool
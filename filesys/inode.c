@@ -33,6 +33,7 @@ struct inode {
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+	unsigned write_gen;                 /* Bumped on every successful write. */
 	struct inode_disk data;             /* Inode content. */
 };
 
@@ -124,6 +125,7 @@ inode_open (disk_sector_t sector) {
 	inode->sector = sector;
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
+	inode->write_gen = 0;
 	inode->removed = false;
 	disk_read (filesys_disk, inode->sector, &inode->data);
 	return inode;
@@ -284,6 +286,9 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 	}
 	free (bounce);
 
+	if (bytes_written > 0)
+		inode->write_gen++;
+
 	return bytes_written;
 }
 
@@ -306,6 +311,14 @@ inode_allow_write (struct inode *inode) {
 	inode->deny_write_cnt--;
 }
 
+/* Returns INODE's write generation.  The value changes whenever
+ * INODE's data is modified while it stays open, so a caller that
+ * keeps INODE open can use it to detect stale cached contents. */
+unsigned
+inode_get_generation (const struct inode *inode) {
+	return inode->write_gen;
+}
+
 /* Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (const struct inode *inode) {
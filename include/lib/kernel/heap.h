@@ -0,0 +1,69 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Priority heap.
+ *
+ * This is a pairing heap.  Like the linked list and the hash
+ * table, it does not use dynamic allocation: each structure that
+ * can be in a heap embeds a struct heap_elem member, and the
+ * heap_entry macro converts a struct heap_elem back to the
+ * structure that contains it.  Refer to lib/kernel/list.h for a
+ * detailed explanation of the technique.
+ *
+ * The top of the heap is an element that no other element is
+ * less than, as decided by the heap's heap_less_func.  Finding
+ * it takes O(1) time, inserting takes O(1) time, and removing
+ * any element takes O(lg n) amortized time.  Elements that
+ * compare equal come out in no particular order.
+ *
+ * An element's key may change while it is in a heap, as long as
+ * heap_raise() or heap_update() is called right after.  Moving an
+ * element toward the top with heap_raise() takes O(1) time. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem {
+	struct heap_elem *child;    /* First child. */
+	struct heap_elem *sibling;  /* Next sibling. */
+	struct heap_elem *prev;     /* Previous sibling, or parent if first. */
+};
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+ * the structure that HEAP_ELEM is embedded inside.  Supply the
+ * name of the outer structure STRUCT and the member name MEMBER
+ * of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)           \
+	((STRUCT *) ((uint8_t *) (HEAP_ELEM)            \
+		- offsetof (STRUCT, MEMBER)))
+
+/* Compares the value of two heap elements A and B, given
+ * auxiliary data AUX.  Returns true if A belongs nearer the top
+ * than B, or false otherwise. */
+typedef bool heap_less_func (const struct heap_elem *a,
+		const struct heap_elem *b,
+		void *aux);
+
+/* Heap. */
+struct heap {
+	struct heap_elem *root;     /* Top element, or NULL if empty. */
+	size_t elem_cnt;            /* Number of elements in heap. */
+	heap_less_func *less;       /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `less'. */
+};
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+void heap_push (struct heap *, struct heap_elem *);
+struct heap_elem *heap_top (const struct heap *);
+struct heap_elem *heap_pop (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+void heap_raise (struct heap *, struct heap_elem *);
+void heap_update (struct heap *, struct heap_elem *);
+
+size_t heap_size (const struct heap *);
+bool heap_empty (const struct heap *);
+
+#endif /* lib/kernel/heap.h */
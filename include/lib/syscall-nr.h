@@ -36,6 +36,17 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extra for Project 3 */
+	SYS_STACK_RESERVE,          /* Set the stack limit and pre-fault size. */
+	SYS_RSS_LIMIT,              /* Cap the resident set of the process. */
+	SYS_VMSTAT,                 /* Snapshot the VM counters. */
+	SYS_FAULT_LATENCY,          /* Copy out page fault latency histograms. */
+	SYS_MEMMAP,                 /* Summarize the memory map by region. */
+	SYS_CHECKPOINT,             /* Save the process to a file. */
+	SYS_SHM_OPEN,               /* Open or create a shared memory object. */
+	SYS_SHM_MAP,                /* Map a shared memory object. */
+	SYS_SHM_UNLINK,             /* Remove a shared memory object's name. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <vmstat.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -41,6 +42,15 @@ int dup2(int oldfd, int newfd);
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
+bool stack_reserve (size_t limit, size_t prefault);
+bool rss_limit (size_t limit);
+bool vmstat (struct vmstat *);
+bool fault_latency (struct fault_hist *, bool all);
+int memmap (struct mem_region *, int max);
+int checkpoint (const char *file);
+int shm_open (const char *name, size_t size);
+void *shm_map (int shmid, void *addr);
+bool shm_unlink (const char *name);
 
 /* Project 4 only. */
 bool chdir (const char *dir);
@@ -0,0 +1,68 @@
+#ifndef __LIB_VMSTAT_H
+#define __LIB_VMSTAT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* System-wide virtual memory counters, as returned by the vmstat
+   system call.  Page counts are in pages. */
+struct vmstat {
+	uint64_t user_frames_free;      /* Free pages in the user pool. */
+	uint64_t user_frames_used;      /* Allocated pages in the user pool. */
+	uint64_t anon_resident;         /* Anonymous pages mapped to a frame. */
+	uint64_t file_resident;         /* File-backed pages mapped to a frame. */
+	uint64_t swap_slots_used;       /* Swap slots holding a page. */
+	uint64_t minor_faults;          /* Faults served without disk I/O. */
+	uint64_t major_faults;          /* Faults that read a file or swap. */
+	uint64_t swap_ins;              /* Pages read back from swap. */
+	uint64_t swap_outs;             /* Pages written to swap. */
+	uint64_t evict_local;           /* Evictions by a process at its RSS cap. */
+	uint64_t evict_clock;           /* Evictions by the clock sweep. */
+	uint64_t evict_fallback;        /* Evictions after every frame was spared. */
+	uint64_t writeback_bytes;       /* Bytes of dirty file pages written back. */
+};
+
+/* Page fault classes timed by the fault latency histograms. */
+enum fault_class {
+	FAULT_STACK,                    /* Stack growth. */
+	FAULT_ANON,                     /* First touch of a zero-filled page. */
+	FAULT_FILE,                     /* First touch of a page loaded from a file. */
+	FAULT_SWAP_IN,                  /* Anonymous page read back from swap. */
+	FAULT_FILE_REREAD,              /* Evicted file page read back from its file. */
+	FAULT_COW,                      /* Write to a page shared by fork. */
+	FAULT_EVICT,                    /* Eviction done to find a free frame. */
+	FAULT_CLASS_CNT
+};
+
+/* Fault latencies in TSC cycles.  Bucket B of a class counts
+   faults that took from 2**B up to 2**(B+1) cycles; the last
+   bucket also takes everything slower. */
+#define FAULT_HIST_BUCKETS 32
+struct fault_hist {
+	uint64_t count[FAULT_CLASS_CNT][FAULT_HIST_BUCKETS];
+};
+
+/* Kinds of memory map regions. */
+enum region_type {
+	REGION_ANON,                    /* Anonymous memory, including the executable. */
+	REGION_FILE,                    /* A memory-mapped file. */
+	REGION_STACK,                   /* The user stack. */
+	REGION_SHM                      /* A named shared memory object. */
+};
+
+/* One region of a process's memory map, as returned by the memmap
+   system call: a run of adjacent pages of the same type, writability
+   and backing file.  Page counts are in pages. */
+struct mem_region {
+	uintptr_t start;                /* First byte of the region. */
+	uintptr_t end;                  /* One past the last byte. */
+	enum region_type type;          /* Kind of region. */
+	bool writable;                  /* Writable by the process? */
+	uint32_t resident;              /* Pages mapped to a frame. */
+	uint32_t swapped;               /* Pages held in swap slots. */
+	uint32_t untouched;             /* Pages never faulted in. */
+	uint32_t dirty;                 /* Resident pages with the dirty bit set. */
+	uint32_t accessed;              /* Resident pages with the accessed bit set. */
+};
+
+#endif /* lib/vmstat.h */
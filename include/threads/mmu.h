@@ -2,12 +2,14 @@
 #define THREAD_MMU_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include "threads/pte.h"
 
 typedef bool pte_for_each_func (uint64_t *pte, void *va, void *aux);
 
 uint64_t *pml4e_walk (uint64_t *pml4, const uint64_t va, int create);
+uint64_t *pml4_pde_walk (uint64_t *pml4, const uint64_t va, int create);
 uint64_t *pml4_create (void);
 bool pml4_for_each (uint64_t *, pte_for_each_func *, void *);
 void pml4_destroy (uint64_t *pml4);
@@ -19,6 +21,13 @@ bool pml4_is_dirty (uint64_t *pml4, const void *upage);
 void pml4_set_dirty (uint64_t *pml4, const void *upage, bool dirty);
 bool pml4_is_accessed (uint64_t *pml4, const void *upage);
 void pml4_set_accessed (uint64_t *pml4, const void *upage, bool accessed);
+void mmu_init (void);
+bool pml4_share_user (uint64_t *dst, uint64_t *src);
+bool pml4_unshare (uint64_t *pml4, const void *upage);
+void pml4_reclaim (uint64_t *pml4, const void *upage, size_t size);
+bool pml4_move_page (uint64_t *pml4, void *upage, void *kpage);
+bool pml4_make_writable (uint64_t *pml4, void *upage);
+void mmu_print_stats (void);
 
 #define is_writable(pte) (*(pte) & PTE_W)
 #define is_user_pte(pte) (*(pte) & PTE_U)
@@ -26,6 +35,14 @@ void pml4_set_accessed (uint64_t *pml4, const void *upage, bool accessed);
 
 #define pte_get_paddr(pte) (pg_round_down(*(pte)))
 
+/* Control register bits. */
+#define CR0_WP (1 << 16)        /* Write protect: kernel obeys read-only PTEs. */
+#define CR4_PGE (1 << 7)        /* Global pages survive CR3 loads. */
+#define CR4_PCIDE (1 << 17)     /* Process-context identifiers in CR3. */
+
+/* CPUID leaf 1 feature bits. */
+#define CPUID_1_ECX_PCID (1 << 17)
+
 /* Segment descriptors for x86-64. */
 struct desc_ptr {
 	uint16_t size;
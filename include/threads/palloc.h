@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -8,16 +9,24 @@
 enum palloc_flags {
 	PAL_ASSERT = 001,           /* Panic on failure. */
 	PAL_ZERO = 002,             /* Zero page contents. */
-	PAL_USER = 004              /* User page. */
+	PAL_USER = 004,             /* User page. */
+	PAL_ANY = 010               /* Kernel page, from the user pool if need be. */
 };
 
 /* Maximum number of pages to put in user pool. */
 extern size_t user_page_limit;
 
+/* Moves whatever lives in the user page KPAGE to another page,
+   leaving KPAGE allocated to the caller.  Returns false if the page
+   cannot be moved. */
+typedef bool palloc_migrate_func (void *kpage);
+
 uint64_t palloc_init (void);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+void palloc_set_migrator (palloc_migrate_func *);
+void palloc_user_usage (size_t *used_cnt, size_t *free_cnt);
 
 #endif /* threads/palloc.h */
@@ -28,6 +28,8 @@
 #define PTX(la)  ((((uint64_t) (la)) >> PTXSHIFT) & 0x1FF)
 #define PTE_ADDR(pte) ((uint64_t) (pte) & ~0xFFF)
 
+#define LARGE_PGSIZE (1UL << PDXSHIFT)   /* Bytes mapped by a PTE_PS entry. */
+
 /* The important flags are listed below.
    When a PDE or PTE is not "present", the other flags are
    ignored.
@@ -41,5 +43,8 @@
 #define PTE_U 0x4                        /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20                       /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40                       /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80                      /* 1=PDE maps a 2 MiB page, 0=points at a page table. */
+#define PTE_G 0x100                      /* 1=global, kept in the TLB across CR3 loads. */
+#define PTE_SHARED 0x200                 /* PDE points at a page table shared by fork (AVL). */
 
 #endif /* threads/pte.h */
@@ -1,13 +1,15 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* Waiting threads, by priority. */
 };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -16,10 +18,22 @@ bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
 
+/* Priority donation from the waiters of something a thread
+   holds.  While any of them waits, it is in the holder's
+   donations, keyed by the best waiter's priority. */
+struct donation {
+	struct heap_elem elem;      /* In holder's donations. */
+	struct heap *waiters[2];    /* Donating waiters; second may be NULL. */
+	bool active;                /* In holder's donations? */
+};
+
 /* Lock. */
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
-	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	volatile uintptr_t owner;   /* Holder, or 0, plus LOCK_WAITERS bit. */
+	struct thread *handoff;     /* Waiter woken to take the lock, or NULL. */
+	struct heap waiters;        /* Waiting threads, by priority. */
+	struct donation donation;   /* Waiters' donation to holder. */
 };
 
 void lock_init (struct lock *);
@@ -28,9 +42,40 @@ bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
+/* Reader-writer lock.  Any number of readers or a single writer
+   may hold it.  Writers are preferred: a new reader waits while a
+   writer holds the lock or waits for it.  Waiters donate priority
+   to the writer or to every reader. */
+struct rwlock {
+	struct thread *writer;      /* Thread holding it for writing. */
+	int reader_cnt;             /* Threads holding it for reading. */
+	int writer_wakeups;         /* Writers woken but not yet running. */
+	struct list readers;        /* Readers' struct rw_hold. */
+	struct heap read_waiters;   /* Waiting readers, by priority. */
+	struct heap write_waiters;  /* Waiting writers, by priority. */
+	struct donation donation;   /* Waiters' donation to writer. */
+};
+
+/* Most rwlocks a thread may hold for reading at once. */
+#define RW_HOLD_MAX 4
+
+/* A thread's hold on an rwlock for reading. */
+struct rw_hold {
+	struct list_elem elem;      /* In the rwlock's readers. */
+	struct thread *thread;      /* Reader. */
+	struct rwlock *rwlock;      /* Lock held, or NULL if unused. */
+	struct donation donation;   /* Waiters' donation to reader. */
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+
 /* Condition variable. */
 struct condition {
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* Waiting threads, by priority. */
 };
 
 void cond_init (struct condition *);
@@ -38,10 +83,11 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
-bool compare_sema_priority (const struct list_elem *a,
- const struct list_elem *b, void *aux);
+bool donation_less (const struct heap_elem *a,
+ const struct heap_elem *b, void *aux);
+void synch_priority_changed (struct thread *, bool raised);
 
-void upadte_priority (void);
+void update_priority (void);
 
 /* Optimization barrier.
  *
@@ -7,6 +7,7 @@
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "lib/kernel/hash.h"
+#include "lib/kernel/heap.h"
 #ifdef VM
 #include "vm/vm.h"
 #endif
@@ -81,12 +82,9 @@ typedef int tid_t;
  * the `magic' member of the running thread's `struct thread' is
  * set to THREAD_MAGIC.  Stack overflow will normally change this
  * value, triggering the assertion. */
-/* The `elem' member has a dual purpose.  It can be an element in
- * the run queue (thread.c), or it can be an element in a
- * semaphore wait list (synch.c).  It can be used these two ways
- * only because they are mutually exclusive: only a thread in the
- * ready state is on the run queue, whereas only a thread in the
- * blocked state is on a semaphore wait list. */
+/* The `elem' member is an element in the run queue (thread.c).
+ * A thread blocked on a semaphore or lock is instead in its
+ * waiters heap through `wait_elem' (synch.c). */
 struct thread {
 	/* Owned by thread.c. */
 	tid_t tid;                          /* Thread identifier. */
@@ -99,19 +97,28 @@ struct thread {
 
 	/*time to wake up*/
 	int64_t wakeup_ticks; 
+	struct heap_elem sleep_elem;        /* Element in sleep_heap. */
 
 	int original_priority;
 
 	struct lock *wait_on_lock;
+	struct rwlock *wait_on_rwlock;
 
-	struct list donations;
+	struct heap donations;              /* Donations of held locks' waiters. */
+	struct rw_hold rw_holds[RW_HOLD_MAX]; /* Rwlocks held for reading. */
 
-	struct list_elem d_elem;
+	/* Waiting on a semaphore, lock or condition, owned by synch.c. */
+	struct heap_elem wait_elem;         /* In a semaphore's or lock's waiters. */
+	uint64_t wait_seq;                  /* Orders equal-priority waiters. */
+	struct heap *wait_heap;             /* Heap to fix on priority change. */
+	struct heap_elem *wait_node;        /* This thread's element in it. */
 
 	struct list_elem all_elem;
 
 	int recent_cpu;
 
+	int64_t cpu_seconds;                /* Seconds of decay in recent_cpu. */
+
 	int nice;
 
 	int exit_status;
@@ -143,10 +150,17 @@ struct thread {
 	/* Table for whole virtual memory owned by thread. */
 	struct supplemental_page_table spt;
 	void *rsp;
+	void *stack_bottom;                 /* Lowest mapped stack page. */
+	void *stack_floor;                  /* Stack may not grow below this. */
+	size_t stack_prefault;              /* Bytes mapped ahead on growth. */
+	size_t rss_limit;                   /* Most resident pages, 0 for no cap. */
+	size_t rss_cnt;                     /* Pages mapped to a frame. */
+	size_t swap_cnt;                    /* Pages held in swap slots. */
+	struct fault_hist *fault_hist;      /* Fault latencies, or NULL. */
 #endif
 
 	/* Owned by thread.c. */
-	struct intr_frame tf;               /* Information for switching */
+	uint64_t ctx_rsp;                   /* Stack pointer while switched out. */
 	unsigned magic;                     /* Detects stack overflow. */
 
 	// struct hash vm; /*Hash table to manage virtual address space of thread*/
@@ -164,6 +178,7 @@ void thread_start (void);
 
 void thread_tick (void);
 void thread_print_stats (void);
+void thread_add_idle_ticks (int64_t);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
@@ -180,6 +195,7 @@ void thread_yield (void);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_change_priority (struct thread *, int);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
@@ -189,6 +205,8 @@ int thread_get_load_avg (void);
 void do_iret (struct intr_frame *tf);
 
 void thread_sleep(int64_t ticks);
+void thread_wakeup(int64_t ticks);
+int64_t thread_next_wakeup (void);
 
 bool compare_priority (const struct list_elem *a,
  const struct list_elem *b, void *aux);
@@ -196,10 +214,9 @@ bool compare_priority (const struct list_elem *a,
 int ready_threads (void);
 void increment_recent_cpu(void);
 void calculate_load_avg(void);
+void decay_recent_cpu(void);
 void calculate_recent_cpu(struct thread *curr);
 void calculate_priority(struct thread *curr);
-void recalculate_priority(void);
-void recalculate_recent_cpu(void);
 
 
 #define FDT_PAGES 3
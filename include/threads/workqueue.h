@@ -0,0 +1,65 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+/* Workqueues.
+ *
+ * A workqueue runs deferred work on a shared pool of kernel
+ * worker threads, so that a subsystem can push work off its
+ * critical path without a daemon of its own.  Each queue has a
+ * priority, which its work runs at, and a limit on how many of
+ * its items may run at once.  Items on one queue start in the
+ * order they were queued.  The pool starts with one worker and
+ * grows, up to WQ_WORKERS, while work waits with no worker idle.
+ *
+ * The caller owns each struct work and must keep it alive until
+ * it has run or been cancelled.  Work may be queued from an
+ * interrupt handler. */
+
+#include <heap.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Most worker threads in the pool. */
+#define WQ_WORKERS 4
+
+typedef void work_func (void *aux);
+
+/* A unit of deferred work. */
+struct work {
+	struct list_elem elem;      /* In its queue's pending list. */
+	work_func *func;            /* Function to run. */
+	void *aux;                  /* Argument for FUNC. */
+	struct workqueue *wq;       /* Queue it is pending on, or NULL. */
+};
+
+/* Work that is queued once a timer runs out. */
+struct delayed_work {
+	struct work work;           /* Queued when the timer runs out. */
+	struct heap_elem timer_elem; /* In the timer heap. */
+	int64_t expires;            /* Timer tick to queue at. */
+	struct workqueue *wq;       /* Queue to use while timing, or NULL. */
+};
+
+/* Queue for work with no needs of its own: PRI_DEFAULT, and as
+   many items at once as there are workers. */
+extern struct workqueue *system_wq;
+
+void workqueue_init (void);
+struct workqueue *workqueue_create (const char *name, int priority,
+		int max_active);
+
+void work_init (struct work *, work_func *, void *aux);
+bool queue_work (struct workqueue *, struct work *);
+bool cancel_work (struct work *);
+bool work_pending (const struct work *);
+
+void delayed_work_init (struct delayed_work *, work_func *, void *aux);
+bool queue_delayed_work (struct workqueue *, struct delayed_work *,
+		int64_t ticks);
+bool cancel_delayed_work (struct delayed_work *);
+
+void workqueue_timer (int64_t ticks);
+int64_t workqueue_next_timer (void);
+
+#endif /* threads/workqueue.h */
@@ -3,6 +3,8 @@
 
 #include "threads/thread.h"
 
+struct inode;
+
 bool lazy_load_segment (struct page *page, void *aux);
 tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
@@ -10,5 +12,7 @@ int process_exec (void *f_name);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (struct thread *next);
+void exec_cache_init (void);
+void exec_cache_forget (struct inode *);
 
 #endif /* userprog/process.h */
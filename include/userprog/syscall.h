@@ -4,10 +4,11 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <vmstat.h>
 #include "threads/interrupt.h"
 #include "include/filesys/off_t.h"
 
-struct lock filesys_lock;
+struct rwlock filesys_lock;
 bool check_addr(char *addr);
 //int create_fd(struct file *f);
 void del_fd(int fd);
@@ -35,4 +36,13 @@ int dup2(int oldfd, int newfd);
 
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
+bool stack_reserve (size_t limit, size_t prefault);
+bool rss_limit (size_t limit);
+bool vmstat (struct vmstat *stat);
+bool fault_latency (struct fault_hist *hist, bool all);
+int memmap (struct mem_region *regions, int max);
+int checkpoint (const char *file, struct intr_frame *f);
+int shm_open (const char *name, size_t size);
+void *shm_map (int shmid, void *addr);
+bool shm_unlink (const char *name);
 #endif /* userprog/syscall.h */
@@ -8,9 +8,15 @@ struct anon_page {
     // int slot_no; // swap out될 때 이 페이지가 저장된 slot의 번호
     int sec_no;
     struct thread *thread;
+    bool stack;             /* Allocated with VM_STACK? */
 };
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+bool anon_swap_dup (struct page *dst, struct page *src);
+int anon_swap_alloc (void);
+void anon_swap_write (int sec_no, const void *kva);
+void anon_swap_read (int sec_no, void *kva);
+void anon_swap_free (int sec_no);
 
 #endif
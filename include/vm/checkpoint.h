@@ -0,0 +1,13 @@
+#ifndef VM_CHECKPOINT_H
+#define VM_CHECKPOINT_H
+
+#include <stdbool.h>
+#include "threads/interrupt.h"
+
+struct file;
+
+int checkpoint_save (const char *file_name, struct intr_frame *f);
+bool checkpoint_is_image (struct file *file);
+bool checkpoint_restore (struct file *file, struct intr_frame *if_);
+
+#endif /* vm/checkpoint.h */
@@ -0,0 +1,27 @@
+#ifndef VM_SHM_H
+#define VM_SHM_H
+#include "vm/vm.h"
+struct page;
+enum vm_type;
+struct shm_object;
+struct supplemental_page_table;
+
+/* Longest name of a shared memory object. */
+#define SHM_NAME_MAX 14
+
+struct shm_page {
+	struct shm_object *obj;     /* Object the page maps. */
+	size_t idx;                 /* Page number within OBJ. */
+};
+
+void vm_shm_init (void);
+int shm_create (const char *name, size_t size);
+void *shm_attach (int id, void *addr);
+bool shm_remove (const char *name);
+struct page *shm_page_dup (struct page *src);
+void shm_lock_acquire (void);
+void shm_lock_release (void);
+struct frame *shm_get_frame (struct page *page);
+bool shm_is_swapped (struct page *page);
+
+#endif
@@ -1,7 +1,9 @@
 #ifndef VM_VM_H
 #define VM_VM_H
 #include <stdbool.h>
+#include <vmstat.h>
 #include "threads/palloc.h"
+#include "threads/interrupt.h"
 #include "hash.h"
 enum vm_type {
 	/* page not initialized */
@@ -12,6 +14,8 @@ enum vm_type {
 	VM_FILE = 2,
 	/* page that hold the page cache, for project 4 */
 	VM_PAGE_CACHE = 3,
+	/* page of a named shared memory object */
+	VM_SHM = 4,
 
 	/* Bit flags to store state */
 
@@ -27,6 +31,7 @@ enum vm_type {
 #include "vm/uninit.h"
 #include "vm/anon.h"
 #include "vm/file.h"
+#include "vm/shm.h"
 #ifdef EFILESYS
 #include "filesys/page_cache.h"
 #endif
@@ -36,6 +41,20 @@ struct thread;
 
 #define VM_TYPE(type) ((type) & 7)
 
+/* Marks an anonymous page as part of the user stack. */
+#define VM_STACK VM_MARKER_0
+
+/* Default and largest stack reservation of a process, in bytes. */
+#define STACK_LIMIT_DEFAULT (1 << 20)
+#define STACK_LIMIT_MAX (64 << 20)
+
+/* Most clock sweeps a cold frame is spared because its owner has
+ * high priority, so that no process's pages are starved of eviction. */
+#define EVICT_BIAS_MAX 3
+
+/* Smallest resident set cap a process may ask for, in bytes. */
+#define RSS_LIMIT_MIN (16 * PGSIZE)
+
 /* The representation of "page".
  * This is kind of "parent class", which has four "child class"es, which are
  * uninit_page, file_page, anon_page, and page cache (project4).
@@ -51,12 +70,15 @@ struct page {
 	/* ... other members */
 	bool writable;
 	int mmap_cnt;
+	struct list_elem frame_page_elem;  /* List element for frame->pages. */
+	struct thread *owner;              /* Process whose address space holds the page. */
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
 	union {
 		struct uninit_page uninit;
 		struct anon_page anon;
 		struct file_page file;
+		struct shm_page shm;
 #ifdef EFILESYS
 		struct page_cache page_cache;
 #endif
@@ -66,8 +88,12 @@ struct page {
 /* The representation of "frame" */
 struct frame {
 	void *kva;
-	struct page *page;
+	struct page *page;           /* First of PAGES; eviction uses it. */
 	struct list_elem frame_elem;
+	struct list pages;           /* Pages mapped to this frame after fork. */
+	int ref_cnt;                 /* Number of PAGES. */
+	int pin_cnt;                 /* Nonzero while kernel I/O uses the frame. */
+	int spared;                  /* Cold sweeps survived for its owner's priority. */
 };
 
 struct slot
@@ -120,6 +146,12 @@ bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page (struct page *page);
 bool vm_claim_page (void *va);
+void *vm_frame_detach (struct page *page);
+void vm_frame_release (struct page *page);
+bool vm_pin_range (const void *uaddr, size_t size, bool write);
+void vm_unpin_range (const void *uaddr, size_t size);
+bool vm_set_stack_limit (size_t limit, size_t prefault);
+bool vm_set_rss_limit (size_t limit);
 enum vm_type page_get_type (struct page *page);
 
 unsigned page_hash (const struct hash_elem *p_, void *aux UNUSED);
@@ -129,12 +161,29 @@ struct page *page_lookup (const void *address);
 struct lazy_load_info
 {
     struct file *file;
+    uint8_t *upage;     /* First page described, at OFFSET. */
     off_t offset;
     uint32_t read_bytes;
     uint32_t zero_bytes;
 	bool writable;
 };
 
+/* System-wide counters for the vmstat system call.  Updates go
+ * through vm_stat_add() so that a snapshot taken with interrupts
+ * off is consistent. */
+extern struct vmstat vm_stat;
+#define vm_stat_add(FIELD, N)                                   \
+	do {                                                        \
+		enum intr_level old_level_ = intr_disable ();           \
+		vm_stat.FIELD += (N);                                   \
+		intr_set_level (old_level_);                            \
+	} while (0)
+void vm_get_stat (struct vmstat *);
+void vm_get_fault_hist (struct fault_hist *, bool all);
+void vm_print_stats (void);
+int vm_get_regions (struct mem_region *, int max);
+struct page **spt_sorted_pages (struct supplemental_page_table *, size_t *cnt);
+
 struct list swap_table;
 struct list frame_table;
 struct lock swap_table_lock;
@@ -0,0 +1,191 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* A pairing heap is a tree in which no element is less than its
+   parent.  The children of an element form a list through their
+   `sibling' links, and each element's `prev' link points to its
+   left sibling or, for the first child, to its parent, so that
+   an element can be cut out of the tree without a search.
+
+   Two heaps merge in O(1) time: the root that is not less than
+   the other becomes the first child of the other.  Removing an
+   element merges its children back together in two passes,
+   first in pairs from left to right and then the pairs from
+   right to left, which keeps the amortized cost at O(lg n). */
+
+static struct heap_elem *meld (struct heap *, struct heap_elem *,
+		struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+static void detach (struct heap_elem *);
+
+/* Initializes HEAP as an empty heap ordered by LESS given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *heap, heap_less_func *less, void *aux) {
+	ASSERT (heap != NULL);
+	ASSERT (less != NULL);
+
+	heap->root = NULL;
+	heap->elem_cnt = 0;
+	heap->less = less;
+	heap->aux = aux;
+}
+
+/* Inserts ELEM into HEAP. */
+void
+heap_push (struct heap *heap, struct heap_elem *elem) {
+	ASSERT (heap != NULL);
+	ASSERT (elem != NULL);
+
+	elem->child = elem->sibling = elem->prev = NULL;
+	heap->root = meld (heap, heap->root, elem);
+	heap->elem_cnt++;
+}
+
+/* Returns the top element of HEAP, or a null pointer if HEAP is
+   empty. */
+struct heap_elem *
+heap_top (const struct heap *heap) {
+	ASSERT (heap != NULL);
+
+	return heap->root;
+}
+
+/* Removes the top element of HEAP and returns it.  Undefined
+   behavior if HEAP is empty. */
+struct heap_elem *
+heap_pop (struct heap *heap) {
+	struct heap_elem *top = heap->root;
+
+	ASSERT (top != NULL);
+
+	heap_remove (heap, top);
+	return top;
+}
+
+/* Removes ELEM, which must be in HEAP, from HEAP. */
+void
+heap_remove (struct heap *heap, struct heap_elem *elem) {
+	struct heap_elem *sub;
+
+	ASSERT (heap != NULL);
+	ASSERT (elem != NULL);
+	ASSERT (heap->elem_cnt > 0);
+
+	sub = merge_pairs (heap, elem->child);
+	if (elem == heap->root)
+		heap->root = sub;
+	else {
+		detach (elem);
+		heap->root = meld (heap, heap->root, sub);
+	}
+	elem->child = elem->sibling = elem->prev = NULL;
+	heap->elem_cnt--;
+}
+
+/* Restores the order of HEAP after the key of ELEM, which must be
+   in HEAP, has moved toward the top. */
+void
+heap_raise (struct heap *heap, struct heap_elem *elem) {
+	ASSERT (heap != NULL);
+	ASSERT (elem != NULL);
+
+	/* ELEM's subtree is still in order; only the link to its
+	   parent may be wrong. */
+	if (elem != heap->root) {
+		detach (elem);
+		heap->root = meld (heap, heap->root, elem);
+	}
+}
+
+/* Restores the order of HEAP after the key of ELEM, which must be
+   in HEAP, has changed in either direction. */
+void
+heap_update (struct heap *heap, struct heap_elem *elem) {
+	heap_remove (heap, elem);
+	heap_push (heap, elem);
+}
+
+/* Returns the number of elements in HEAP. */
+size_t
+heap_size (const struct heap *heap) {
+	return heap->elem_cnt;
+}
+
+/* Returns true if HEAP contains no elements, false otherwise. */
+bool
+heap_empty (const struct heap *heap) {
+	return heap->root == NULL;
+}
+
+/* Merges the trees rooted at A and B, either of which may be
+   null, and returns the new root.  A and B must have no
+   siblings. */
+static struct heap_elem *
+meld (struct heap *heap, struct heap_elem *a, struct heap_elem *b) {
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+	if (heap->less (b, a, heap->aux)) {
+		struct heap_elem *t = a;
+		a = b;
+		b = t;
+	}
+
+	b->prev = a;
+	b->sibling = a->child;
+	if (a->child != NULL)
+		a->child->prev = b;
+	a->child = b;
+	a->prev = NULL;
+	return a;
+}
+
+/* Merges FIRST and its siblings into a single tree and returns
+   its root, or a null pointer if FIRST is null. */
+static struct heap_elem *
+merge_pairs (struct heap *heap, struct heap_elem *first) {
+	struct heap_elem *pairs = NULL;
+	struct heap_elem *root = NULL;
+
+	/* Left to right, meld each pair and stack the result. */
+	while (first != NULL) {
+		struct heap_elem *a = first;
+		struct heap_elem *b = a->sibling;
+
+		first = b != NULL ? b->sibling : NULL;
+		a->sibling = a->prev = NULL;
+		if (b != NULL) {
+			b->sibling = b->prev = NULL;
+			a = meld (heap, a, b);
+		}
+		a->sibling = pairs;
+		pairs = a;
+	}
+
+	/* Right to left, meld the pairs into one tree. */
+	while (pairs != NULL) {
+		struct heap_elem *next = pairs->sibling;
+
+		pairs->sibling = NULL;
+		root = meld (heap, root, pairs);
+		pairs = next;
+	}
+	return root;
+}
+
+/* Cuts the subtree rooted at ELEM, which must not be a root,
+   out of its parent's list of children. */
+static void
+detach (struct heap_elem *elem) {
+	ASSERT (elem->prev != NULL);
+
+	if (elem->prev->child == elem)
+		elem->prev->child = elem->sibling;
+	else
+		elem->prev->sibling = elem->sibling;
+	if (elem->sibling != NULL)
+		elem->sibling->prev = elem->prev;
+	elem->sibling = elem->prev = NULL;
+}
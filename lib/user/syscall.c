@@ -194,3 +194,48 @@ int
 umount (const char *path) {
 	return syscall1 (SYS_UMOUNT, path);
 }
+
+bool
+stack_reserve (size_t limit, size_t prefault) {
+	return syscall2 (SYS_STACK_RESERVE, limit, prefault);
+}
+
+bool
+rss_limit (size_t limit) {
+	return syscall1 (SYS_RSS_LIMIT, limit);
+}
+
+bool
+vmstat (struct vmstat *stat) {
+	return syscall1 (SYS_VMSTAT, stat);
+}
+
+bool
+fault_latency (struct fault_hist *hist, bool all) {
+	return syscall2 (SYS_FAULT_LATENCY, hist, all);
+}
+
+int
+memmap (struct mem_region *regions, int max) {
+	return syscall2 (SYS_MEMMAP, regions, max);
+}
+
+int
+checkpoint (const char *file) {
+	return syscall1 (SYS_CHECKPOINT, file);
+}
+
+int
+shm_open (const char *name, size_t size) {
+	return syscall2 (SYS_SHM_OPEN, name, size);
+}
+
+void *
+shm_map (int shmid, void *addr) {
+	return (void *) syscall2 (SYS_SHM_MAP, shmid, addr);
+}
+
+bool
+shm_unlink (const char *name) {
+	return syscall1 (SYS_SHM_UNLINK, name);
+}
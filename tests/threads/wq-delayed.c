@@ -0,0 +1,65 @@
+/* Queues delayed work with different delays and checks that each
+   item runs no earlier than its delay, soonest first, and that an
+   item cancelled before its timer runs out never runs. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+struct delayed_item 
+  {
+    struct delayed_work dw;
+    int id;
+    int64_t due;                /* Earliest tick it may run at. */
+  };
+
+static work_func delayed_func;
+static struct semaphore done_sema;
+
+void
+test_wq_delayed (void) 
+{
+  static const int delays[] = {30, 10, 20};
+  struct delayed_item items[3], cancelled;
+  int i;
+
+  sema_init (&done_sema, 0);
+
+  for (i = 0; i < 3; i++) 
+    {
+      items[i].id = i;
+      items[i].due = timer_ticks () + delays[i];
+      delayed_work_init (&items[i].dw, delayed_func, &items[i]);
+      if (!queue_delayed_work (system_wq, &items[i].dw, delays[i]))
+        fail ("could not queue work %d", i);
+    }
+  if (queue_delayed_work (system_wq, &items[0].dw, 5))
+    fail ("queued work 0 while its timer was running");
+
+  cancelled.id = 3;
+  cancelled.due = timer_ticks () + 15;
+  delayed_work_init (&cancelled.dw, delayed_func, &cancelled);
+  queue_delayed_work (system_wq, &cancelled.dw, 15);
+  if (!cancel_delayed_work (&cancelled.dw))
+    fail ("could not cancel work 3");
+
+  for (i = 0; i < 3; i++)
+    sema_down (&done_sema);
+}
+
+static void
+delayed_func (void *item_) 
+{
+  struct delayed_item *item = item_;
+
+  if (timer_ticks () < item->due)
+    fail ("work %d ran %"PRId64" ticks early",
+          item->id, item->due - timer_ticks ());
+  msg ("work %d ran", item->id);
+  sema_up (&done_sema);
+}
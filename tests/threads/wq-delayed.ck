@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(wq-delayed) begin
+(wq-delayed) work 1 ran
+(wq-delayed) work 2 ran
+(wq-delayed) work 0 ran
+(wq-delayed) end
+EOF
+pass;
@@ -0,0 +1,92 @@
+/* Queues items that sleep on a workqueue whose max_active is 1,
+   then on one whose max_active is 2, and checks that neither runs
+   more items at once than its limit.  The first queue must run
+   its items one at a time in the order they were queued, and the
+   second must grow the worker pool to run two at once. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+#define ITEM_CNT 4
+
+struct limit_item 
+  {
+    struct work work;
+    int id;
+  };
+
+static work_func limit_func;
+static struct semaphore done_sema;
+static int running;             /* Items running now. */
+static int most;                /* Most items ever running at once. */
+static bool verbose;            /* Report each item as it starts? */
+
+static void run_queue (int max_active);
+
+void
+test_wq_max_active (void) 
+{
+  sema_init (&done_sema, 0);
+
+  verbose = true;
+  run_queue (1);
+  verbose = false;
+  run_queue (2);
+}
+
+/* Runs ITEM_CNT items on a new queue limited to MAX_ACTIVE and
+   reports the most that ran at once. */
+static void
+run_queue (int max_active) 
+{
+  struct limit_item items[ITEM_CNT];
+  struct workqueue *wq;
+  char name[16];
+  int i;
+
+  snprintf (name, sizeof name, "limit %d", max_active);
+  wq = workqueue_create (name, PRI_DEFAULT, max_active);
+  if (wq == NULL)
+    fail ("could not create workqueue \"%s\"", name);
+
+  running = most = 0;
+  for (i = 0; i < ITEM_CNT; i++) 
+    {
+      items[i].id = i;
+      work_init (&items[i].work, limit_func, &items[i]);
+      queue_work (wq, &items[i].work);
+    }
+  for (i = 0; i < ITEM_CNT; i++)
+    sema_down (&done_sema);
+
+  if (most > max_active)
+    fail ("%d items ran at once on \"%s\"", most, name);
+  msg ("%s: at most %d items ran at once", name, most);
+}
+
+static void
+limit_func (void *item_) 
+{
+  struct limit_item *item = item_;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (++running > most)
+    most = running;
+  intr_set_level (old_level);
+
+  if (verbose)
+    msg ("item %d started", item->id);
+  timer_sleep (10);
+
+  old_level = intr_disable ();
+  running--;
+  intr_set_level (old_level);
+  sema_up (&done_sema);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(wq-max-active) begin
+(wq-max-active) item 0 started
+(wq-max-active) item 1 started
+(wq-max-active) item 2 started
+(wq-max-active) item 3 started
+(wq-max-active) limit 1: at most 1 items ran at once
+(wq-max-active) limit 2: at most 2 items ran at once
+(wq-max-active) end
+EOF
+pass;
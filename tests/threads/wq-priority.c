@@ -0,0 +1,79 @@
+/* Queues items on a low-priority workqueue and then on a
+   high-priority one while no worker can run, and checks that all
+   of the high-priority items run first, each queue in order. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+
+#define ITEM_CNT 3
+
+struct prio_item 
+  {
+    struct work work;
+    const char *queue;
+    int id;
+  };
+
+static work_func prio_func;
+static struct semaphore done_sema;
+
+static void queue_items (struct workqueue *, const char *name,
+                         struct prio_item *);
+
+void
+test_wq_priority (void) 
+{
+  struct prio_item low_items[ITEM_CNT], high_items[ITEM_CNT];
+  struct workqueue *low, *high;
+  enum intr_level old_level;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done_sema, 0);
+
+  /* Both priorities are above ours and above an idle worker's, so
+     the worker that takes the first item runs them all. */
+  low = workqueue_create ("low", PRI_DEFAULT + 1, 1);
+  high = workqueue_create ("high", PRI_DEFAULT + 2, 1);
+  if (low == NULL || high == NULL)
+    fail ("could not create workqueues");
+
+  old_level = intr_disable ();
+  queue_items (low, "low", low_items);
+  queue_items (high, "high", high_items);
+  intr_set_level (old_level);
+
+  for (i = 0; i < 2 * ITEM_CNT; i++)
+    sema_down (&done_sema);
+}
+
+static void
+queue_items (struct workqueue *wq, const char *name,
+             struct prio_item *items) 
+{
+  int i;
+
+  for (i = 0; i < ITEM_CNT; i++) 
+    {
+      items[i].queue = name;
+      items[i].id = i;
+      work_init (&items[i].work, prio_func, &items[i]);
+      queue_work (wq, &items[i].work);
+    }
+}
+
+static void
+prio_func (void *item_) 
+{
+  struct prio_item *item = item_;
+
+  msg ("%s item %d ran", item->queue, item->id);
+  sema_up (&done_sema);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(wq-priority) begin
+(wq-priority) high item 0 ran
+(wq-priority) high item 1 ran
+(wq-priority) high item 2 ran
+(wq-priority) low item 0 ran
+(wq-priority) low item 1 ran
+(wq-priority) low item 2 ran
+(wq-priority) end
+EOF
+pass;
@@ -0,0 +1,75 @@
+/* Executes a copy of child-simple twice, so that the second exec
+   can reuse the program headers parsed by the first.  Then
+   overwrites the copy in place with child-args, without changing
+   its length, and executes it once more.  That exec must run
+   child-args: headers cached from before the rewrite do not match
+   the new contents. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[128 * 1024];
+
+/* Reads file NAME into BUF and returns its size. */
+static int
+read_file (const char *name)
+{
+  int fd, size;
+
+  if ((fd = open (name)) < 2)
+    fail ("open \"%s\" failed", name);
+  size = filesize (fd);
+  if (size > (int) sizeof buf)
+    fail ("\"%s\" is too big", name);
+  if (read (fd, buf, size) != size)
+    fail ("read \"%s\" failed", name);
+  close (fd);
+  return size;
+}
+
+/* Writes the first SIZE bytes of BUF over the start of file NAME. */
+static void
+write_file (const char *name, int size)
+{
+  int fd;
+
+  if ((fd = open (name)) < 2)
+    fail ("open \"%s\" failed", name);
+  if (write (fd, buf, size) != size)
+    fail ("write \"%s\" failed", name);
+  close (fd);
+}
+
+/* Runs "prog" in a child process and returns its exit status. */
+static int
+run_prog (void)
+{
+  int pid = fork ("prog");
+
+  if (pid == 0)
+    {
+      exec ("prog");
+      fail ("exec \"prog\" failed");
+    }
+  return wait (pid);
+}
+
+void
+test_main (void)
+{
+  int args_size = read_file ("child-args");
+  int simple_size = read_file ("child-simple");
+
+  CHECK (create ("prog", args_size > simple_size ? args_size : simple_size),
+         "create \"prog\"");
+  msg ("copy \"child-simple\" to \"prog\"");
+  write_file ("prog", simple_size);
+  CHECK (run_prog () == 81, "exec \"prog\"");
+  CHECK (run_prog () == 81, "exec \"prog\" again");
+
+  msg ("copy \"child-args\" over \"prog\"");
+  read_file ("child-args");
+  write_file ("prog", args_size);
+  CHECK (run_prog () == 0, "exec rewritten \"prog\"");
+}
@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(exec-rewrite) begin
+(exec-rewrite) create "prog"
+(exec-rewrite) copy "child-simple" to "prog"
+(exec-rewrite) exec "prog"
+(child-simple) run
+prog: exit(81)
+(exec-rewrite) exec "prog" again
+(child-simple) run
+prog: exit(81)
+(exec-rewrite) copy "child-args" over "prog"
+(exec-rewrite) exec rewritten "prog"
+(args) begin
+(args) argc = 1
+(args) argv[0] = 'prog'
+(args) argv[1] = null
+(args) end
+prog: exit(0)
+(exec-rewrite) end
+exec-rewrite: exit(0)
+EOF
+pass;
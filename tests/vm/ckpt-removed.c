@@ -0,0 +1,21 @@
+/* Checks that checkpointing fails, and leaves no image behind,
+   while the process has open a file that has been removed, since
+   a restore could not find that file again by name. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  int handle;
+
+  CHECK (create ("scratch", 100), "create \"scratch\"");
+  CHECK ((handle = open ("scratch")) > 1, "open \"scratch\"");
+  CHECK (remove ("scratch"), "remove \"scratch\"");
+  CHECK (checkpoint ("image") == -1, "checkpoint \"image\" fails");
+  CHECK (open ("image") == -1, "no image was left behind");
+  close (handle);
+  CHECK (checkpoint ("image") == 0, "checkpoint \"image\" after close");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(ckpt-removed) begin
+(ckpt-removed) create "scratch"
+(ckpt-removed) open "scratch"
+(ckpt-removed) remove "scratch"
+(ckpt-removed) checkpoint "image" fails
+(ckpt-removed) no image was left behind
+(ckpt-removed) checkpoint "image" after close
+(ckpt-removed) end
+EOF
+pass;
@@ -0,0 +1,51 @@
+/* Saves a checkpoint of a process with data in memory, an open
+   file and a file mapping, resumes it from the image in a child,
+   and checks that the restored process sees the same state. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[8192];
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  int handle;
+  pid_t child;
+  size_t i;
+  int r;
+
+  for (i = 0; i < sizeof buf; i++)
+    buf[i] = i % 251;
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (mmap (actual, 4096, 0, handle, 0) != MAP_FAILED, "mmap \"sample.txt\"");
+  seek (handle, 10);
+
+  r = checkpoint ("image");
+  if (r == 1)
+    {
+      /* Running from the image. */
+      for (i = 0; i < sizeof buf; i++)
+        if (buf[i] != (char) (i % 251))
+          fail ("byte %zu of buf has value %02hhx after restore", i, buf[i]);
+      msg ("restored memory is intact");
+      if (memcmp (actual, sample, strlen (sample)))
+        fail ("restored mapping of \"sample.txt\" reported bad data");
+      msg ("restored mapping is intact");
+      CHECK (tell (handle) == 10, "restored file position is intact");
+      exit (81);
+    }
+  CHECK (r == 0, "checkpoint \"image\"");
+
+  child = fork ("child");
+  if (child == 0)
+    {
+      exec ("image");
+      fail ("exec \"image\" returned");
+    }
+  CHECK (wait (child) == 81, "wait for restored process");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(ckpt-restore) begin
+(ckpt-restore) open "sample.txt"
+(ckpt-restore) mmap "sample.txt"
+(ckpt-restore) checkpoint "image"
+(ckpt-restore) restored memory is intact
+(ckpt-restore) restored mapping is intact
+(ckpt-restore) restored file position is intact
+(ckpt-restore) wait for restored process
+(ckpt-restore) end
+EOF
+pass;
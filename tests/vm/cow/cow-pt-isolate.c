@@ -0,0 +1,50 @@
+/* Forks while a buffer shares its page tables between parent and
+   child, lets both sides write to it, and checks that neither sees
+   the other's writes. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 16
+#define PAGE_SIZE 4096
+
+static char buf[PAGE_CNT * PAGE_SIZE];
+
+/* Returns true if every byte of pages [FIRST, LAST) of buf is C. */
+static bool
+pages_hold (size_t first, size_t last, char c)
+{
+	size_t i;
+
+	for (i = first * PAGE_SIZE; i < last * PAGE_SIZE; i++)
+		if (buf[i] != c)
+			return false;
+	return true;
+}
+
+void
+test_main (void)
+{
+	pid_t child;
+
+	memset (buf, 'a', sizeof buf);
+
+	child = fork ("child");
+	if (child == 0) {
+		CHECK (pages_hold (0, PAGE_CNT, 'a'), "child sees data from before fork");
+		memset (buf, 'c', sizeof buf / 2);
+		CHECK (pages_hold (0, PAGE_CNT / 2, 'c'), "child sees its own writes");
+		CHECK (pages_hold (PAGE_CNT / 2, PAGE_CNT, 'a'),
+				"child's other pages are unchanged");
+		return;
+	}
+	memset (buf + sizeof buf / 4, 'p', sizeof buf / 2);
+	wait (child);
+	CHECK (pages_hold (0, PAGE_CNT / 4, 'a'), "parent's first pages are unchanged");
+	CHECK (pages_hold (PAGE_CNT / 4, PAGE_CNT * 3 / 4, 'p'),
+			"parent sees its own writes");
+	CHECK (pages_hold (PAGE_CNT * 3 / 4, PAGE_CNT, 'a'),
+			"parent's last pages are unchanged");
+}
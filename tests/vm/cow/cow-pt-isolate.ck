@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cow-pt-isolate) begin
+(cow-pt-isolate) child sees data from before fork
+(cow-pt-isolate) child sees its own writes
+(cow-pt-isolate) child's other pages are unchanged
+(cow-pt-isolate) end
+(cow-pt-isolate) parent's first pages are unchanged
+(cow-pt-isolate) parent sees its own writes
+(cow-pt-isolate) parent's last pages are unchanged
+(cow-pt-isolate) end
+EOF
+pass;
@@ -0,0 +1,90 @@
+/* Reads one byte from each page of a fresh file mapping and checks
+   that the process's fault latency histogram gained exactly one
+   file fault per page, and the system-wide histogram at least as
+   many. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define WARM_PAGES 3            /* Pages of "small.txt". */
+#define PAGE_CNT 16
+
+static struct fault_hist mine_before, mine_after, all_before, all_after;
+
+/* Reads the first byte of each of the CNT pages at P. */
+static void
+touch_pages (volatile const char *p, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    (void) p[i * PAGE_SIZE];
+}
+
+/* Takes histogram snapshots before and after reading the CNT
+   pages at P. */
+static void
+measure (const char *p, size_t cnt)
+{
+  if (!fault_latency (&mine_before, false)
+      || !fault_latency (&all_before, true))
+    fail ("fault_latency failed");
+  touch_pages (p, cnt);
+  if (!fault_latency (&mine_after, false)
+      || !fault_latency (&all_after, true))
+    fail ("fault_latency failed");
+}
+
+/* Returns how many more CLASS faults AFTER counts than BEFORE. */
+static uint64_t
+class_delta (const struct fault_hist *before, const struct fault_hist *after,
+             enum fault_class class)
+{
+  uint64_t delta = 0;
+  int bucket;
+
+  for (bucket = 0; bucket < FAULT_HIST_BUCKETS; bucket++)
+    delta += after->count[class][bucket] - before->count[class][bucket];
+  return delta;
+}
+
+void
+test_main (void)
+{
+  const char *warm = (char *) 0x10000000;
+  const char *big = (char *) 0x20000000;
+  uint64_t delta;
+  int handle;
+
+  CHECK ((handle = open ("small.txt")) > 1, "open \"small.txt\"");
+  CHECK (mmap ((void *) warm, WARM_PAGES * PAGE_SIZE, 0, handle, 0) == warm,
+         "mmap \"small.txt\"");
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+  CHECK (mmap ((void *) big, PAGE_CNT * PAGE_SIZE, 0, handle, 0) == big,
+         "mmap \"large.txt\"");
+
+  /* Measure a read of WARM first, to fault in the code and the
+     histogram buffers that the measurement itself uses.  Then the
+     only file faults while measuring BIG are the ones on BIG. */
+  memset (&mine_before, 0, sizeof mine_before);
+  memset (&mine_after, 0, sizeof mine_after);
+  memset (&all_before, 0, sizeof all_before);
+  memset (&all_after, 0, sizeof all_after);
+  measure (warm, WARM_PAGES);
+  msg ("read %d pages of \"small.txt\"", WARM_PAGES);
+  measure (big, PAGE_CNT);
+  msg ("read %d pages of \"large.txt\"", PAGE_CNT);
+
+  delta = class_delta (&mine_before, &mine_after, FAULT_FILE);
+  if (delta != PAGE_CNT)
+    fail ("process histogram gained %llu file faults", delta);
+  msg ("process histogram gained %d file faults", PAGE_CNT);
+
+  delta = class_delta (&all_before, &all_after, FAULT_FILE);
+  if (delta < PAGE_CNT)
+    fail ("system histogram gained %llu file faults", delta);
+  msg ("system histogram gained at least %d file faults", PAGE_CNT);
+}
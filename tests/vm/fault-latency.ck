@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fault-latency) begin
+(fault-latency) open "small.txt"
+(fault-latency) mmap "small.txt"
+(fault-latency) open "large.txt"
+(fault-latency) mmap "large.txt"
+(fault-latency) read 3 pages of "small.txt"
+(fault-latency) read 16 pages of "large.txt"
+(fault-latency) process histogram gained 16 file faults
+(fault-latency) system histogram gained at least 16 file faults
+(fault-latency) end
+EOF
+pass;
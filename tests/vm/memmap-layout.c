@@ -0,0 +1,109 @@
+/* Builds a known memory map: two of the three pages of a read-only
+   file mapping read, and all four pages of a shared memory object
+   written.  Checks the type and page counts that memmap reports for
+   those regions, for the code, and for the stack.  Then caps the
+   resident set so that pages get evicted and checks that every
+   page is still accounted for. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define FILE_PAGES 3            /* Pages of "small.txt". */
+#define SHM_PAGES 4
+#define REGION_MAX 64
+#define USER_STACK 0x47480000
+
+static struct mem_region regions[REGION_MAX];
+static int region_cnt;
+
+/* Reads the memory map into REGIONS. */
+static void
+read_map (void)
+{
+  region_cnt = memmap (regions, REGION_MAX);
+  if (region_cnt < 0 || region_cnt > REGION_MAX)
+    fail ("memmap returned %d", region_cnt);
+}
+
+/* Returns the region of REGIONS that holds ADDR. */
+static const struct mem_region *
+find_region (uintptr_t addr)
+{
+  int i;
+
+  for (i = 0; i < region_cnt; i++)
+    if (regions[i].start <= addr && addr < regions[i].end)
+      return &regions[i];
+  fail ("no region holds %p", (void *) addr);
+}
+
+/* Returns the number of pages in region R. */
+static uint32_t
+region_pages (const struct mem_region *r)
+{
+  return (r->end - r->start) / PAGE_SIZE;
+}
+
+void
+test_main (void)
+{
+  volatile char *file = (char *) 0x10000000;
+  char *shm = (char *) 0x20000000;
+  const struct mem_region *r;
+  int handle, id;
+  size_t i;
+
+  CHECK ((handle = open ("small.txt")) > 1, "open \"small.txt\"");
+  CHECK (mmap ((void *) file, FILE_PAGES * PAGE_SIZE, 0, handle, 0) == file,
+         "mmap \"small.txt\"");
+  CHECK ((id = shm_open ("obj", SHM_PAGES * PAGE_SIZE)) >= 0,
+         "shm_open \"obj\"");
+  CHECK (shm_map (id, shm) == shm, "shm_map \"obj\"");
+  (void) file[0];
+  (void) file[2 * PAGE_SIZE];
+  for (i = 0; i < SHM_PAGES; i++)
+    shm[i * PAGE_SIZE] = 1;
+  read_map ();
+
+  r = find_region ((uintptr_t) file);
+  CHECK (r->start == (uintptr_t) file && region_pages (r) == FILE_PAGES
+         && r->type == REGION_FILE && !r->writable,
+         "file region covers the read-only mapping");
+  CHECK (r->resident == 2 && r->untouched == 1 && r->swapped == 0
+         && r->dirty == 0,
+         "file region has 2 pages resident and 1 untouched");
+
+  r = find_region ((uintptr_t) shm);
+  CHECK (r->start == (uintptr_t) shm && region_pages (r) == SHM_PAGES
+         && r->type == REGION_SHM && r->writable,
+         "shared memory region covers the object");
+  CHECK (r->resident == SHM_PAGES && r->dirty == SHM_PAGES
+         && r->untouched == 0 && r->swapped == 0,
+         "shared memory region has 4 dirty pages resident");
+
+  r = find_region ((uintptr_t) test_main);
+  CHECK (r->type == REGION_ANON && !r->writable,
+         "code is in a read-only anonymous region");
+
+  r = find_region ((uintptr_t) &r);
+  CHECK (r->type == REGION_STACK && r->end == USER_STACK && r->writable,
+         "stack region ends at the top of user memory");
+  CHECK (r->resident == region_pages (r) && r->swapped == 0
+         && r->untouched == 0,
+         "stack region is all resident");
+
+  CHECK (rss_limit (16 * PAGE_SIZE), "cap the resident set at 16 pages");
+  read_map ();
+
+  r = find_region ((uintptr_t) file);
+  CHECK (r->resident <= 2 && r->untouched == 1 && r->swapped == 0,
+         "file pages are dropped, not swapped");
+  r = find_region ((uintptr_t) shm);
+  CHECK (r->resident + r->swapped == SHM_PAGES,
+         "shared memory pages are resident or swapped");
+  r = find_region ((uintptr_t) &r);
+  CHECK (r->resident + r->swapped == region_pages (r),
+         "stack pages are resident or swapped");
+}
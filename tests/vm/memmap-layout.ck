@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(memmap-layout) begin
+(memmap-layout) open "small.txt"
+(memmap-layout) mmap "small.txt"
+(memmap-layout) shm_open "obj"
+(memmap-layout) shm_map "obj"
+(memmap-layout) file region covers the read-only mapping
+(memmap-layout) file region has 2 pages resident and 1 untouched
+(memmap-layout) shared memory region covers the object
+(memmap-layout) shared memory region has 4 dirty pages resident
+(memmap-layout) code is in a read-only anonymous region
+(memmap-layout) stack region ends at the top of user memory
+(memmap-layout) stack region is all resident
+(memmap-layout) cap the resident set at 16 pages
+(memmap-layout) file pages are dropped, not swapped
+(memmap-layout) shared memory pages are resident or swapped
+(memmap-layout) stack pages are resident or swapped
+(memmap-layout) end
+EOF
+pass;
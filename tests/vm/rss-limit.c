@@ -0,0 +1,77 @@
+/* Caps the process's resident set at 32 pages and then writes a
+   1 MB buffer.  Checks that the process never holds more than 32
+   pages, that the pages it had to give up went to swap, and that
+   they read back intact. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 256
+#define RSS_CAP 32
+#define REGION_MAX 64
+
+static char buf[PAGE_CNT * PAGE_SIZE];
+static struct mem_region regions[REGION_MAX];
+
+/* Adds up the resident and swapped pages of every region of the
+   memory map into *RESIDENT and *SWAPPED. */
+static void
+count_pages (size_t *resident, size_t *swapped)
+{
+  int cnt = memmap (regions, REGION_MAX);
+  int i;
+
+  if (cnt < 0 || cnt > REGION_MAX)
+    fail ("memmap returned %d", cnt);
+  *resident = *swapped = 0;
+  for (i = 0; i < cnt; i++)
+    {
+      *resident += regions[i].resident;
+      *swapped += regions[i].swapped;
+    }
+}
+
+void
+test_main (void)
+{
+  struct vmstat before, after;
+  size_t resident, swapped;
+  size_t i;
+
+  CHECK (!rss_limit (4 * PAGE_SIZE), "capping below the minimum fails");
+  CHECK (vmstat (&before), "vmstat");
+  CHECK (rss_limit (RSS_CAP * PAGE_SIZE), "cap the resident set at %d pages",
+         RSS_CAP);
+
+  for (i = 0; i < PAGE_CNT; i++)
+    buf[i * PAGE_SIZE] = i % 251;
+  msg ("wrote %d pages", PAGE_CNT);
+
+  count_pages (&resident, &swapped);
+  if (resident > RSS_CAP)
+    fail ("%zu pages resident", resident);
+  msg ("resident set is within the cap");
+  if (swapped < PAGE_CNT - RSS_CAP)
+    fail ("only %zu pages in swap", swapped);
+  msg ("the excess pages are in swap");
+
+  CHECK (vmstat (&after), "vmstat");
+  if (after.evict_local - before.evict_local < PAGE_CNT - RSS_CAP)
+    fail ("only %llu evictions at the cap",
+          after.evict_local - before.evict_local);
+  msg ("the process evicted its own pages");
+
+  for (i = 0; i < PAGE_CNT; i++)
+    if (buf[i * PAGE_SIZE] != (char) (i % 251))
+      fail ("page %zu has the wrong data", i);
+  msg ("read back %d pages", PAGE_CNT);
+
+  count_pages (&resident, &swapped);
+  if (resident > RSS_CAP)
+    fail ("%zu pages resident after reading back", resident);
+  msg ("resident set is still within the cap");
+
+  CHECK (rss_limit (0), "lift the cap");
+}
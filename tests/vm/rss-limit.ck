@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(rss-limit) begin
+(rss-limit) capping below the minimum fails
+(rss-limit) vmstat
+(rss-limit) cap the resident set at 32 pages
+(rss-limit) wrote 256 pages
+(rss-limit) resident set is within the cap
+(rss-limit) the excess pages are in swap
+(rss-limit) vmstat
+(rss-limit) the process evicted its own pages
+(rss-limit) read back 256 pages
+(rss-limit) resident set is still within the cap
+(rss-limit) lift the cap
+(rss-limit) end
+EOF
+pass;
@@ -0,0 +1,43 @@
+/* Creates a shared memory object and maps it twice in one process.
+   Checks that the object starts out zeroed, that both mappings see
+   the same pages, that opening the name again finds the same
+   object, and that the mappings outlive the name. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 3
+
+void
+test_main (void)
+{
+  char *a = (char *) 0x10000000;
+  char *b = (char *) 0x20000000;
+  size_t i;
+  int id;
+
+  CHECK ((id = shm_open ("obj", PAGE_CNT * PAGE_SIZE - 100)) >= 0,
+         "shm_open \"obj\"");
+  CHECK (shm_open ("obj", 0) == id, "shm_open \"obj\" again");
+  CHECK (shm_map (id, a) == a, "shm_map \"obj\" at a");
+  CHECK (shm_map (id, b) == b, "shm_map \"obj\" at b");
+
+  for (i = 0; i < PAGE_CNT * PAGE_SIZE; i++)
+    if (a[i] != 0)
+      fail ("byte %zu of new object has value %02hhx", i, a[i]);
+  msg ("new object reads as zeros");
+
+  for (i = 0; i < PAGE_CNT * PAGE_SIZE; i++)
+    a[i] = i % 253;
+  if (memcmp (a, b, PAGE_CNT * PAGE_SIZE))
+    fail ("writes through a do not show through b");
+  msg ("both mappings see the same data");
+
+  CHECK (shm_unlink ("obj"), "shm_unlink \"obj\"");
+  CHECK (!shm_unlink ("obj"), "shm_unlink \"obj\" again fails");
+  b[0] = 'y';
+  CHECK (a[0] == 'y', "mappings outlive the name");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(shm-basic) begin
+(shm-basic) shm_open "obj"
+(shm-basic) shm_open "obj" again
+(shm-basic) shm_map "obj" at a
+(shm-basic) shm_map "obj" at b
+(shm-basic) new object reads as zeros
+(shm-basic) both mappings see the same data
+(shm-basic) shm_unlink "obj"
+(shm-basic) shm_unlink "obj" again fails
+(shm-basic) mappings outlive the name
+(shm-basic) end
+EOF
+pass;
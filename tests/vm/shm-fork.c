@@ -0,0 +1,30 @@
+/* Checks that a child inherits its parent's shared memory mapping
+   across fork, and that writes on either side are seen by the
+   other instead of being copied on write. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char *obj = (char *) 0x10000000;
+  pid_t child;
+  int id;
+
+  CHECK ((id = shm_open ("obj", 4096)) >= 0, "shm_open \"obj\"");
+  CHECK (shm_map (id, obj) == obj, "shm_map \"obj\"");
+  strlcpy (obj, "parent", 4096);
+
+  child = fork ("child");
+  if (child == 0)
+    {
+      CHECK (!strcmp (obj, "parent"), "child sees parent's data");
+      strlcpy (obj, "child", 4096);
+      return;
+    }
+  wait (child);
+  CHECK (!strcmp (obj, "child"), "parent sees child's data");
+}
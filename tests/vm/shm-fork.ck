@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(shm-fork) begin
+(shm-fork) shm_open "obj"
+(shm-fork) shm_map "obj"
+(shm-fork) child sees parent's data
+(shm-fork) end
+(shm-fork) parent sees child's data
+(shm-fork) end
+EOF
+pass;
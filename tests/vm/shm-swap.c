@@ -0,0 +1,46 @@
+/* Maps a shared memory object larger than physical memory, so that
+   its frames are swapped out, and checks that both a parent and a
+   child it forked read back what the other wrote to every page.
+   For this test, Pintos memory size is 10MB. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define OBJ_SIZE (20 << 20)
+#define PAGE_CNT (OBJ_SIZE / PAGE_SIZE)
+
+void
+test_main (void)
+{
+  char *obj = (char *) 0x10000000;
+  pid_t child;
+  size_t i;
+  int id;
+
+  CHECK ((id = shm_open ("big", OBJ_SIZE)) >= 0, "shm_open \"big\"");
+  CHECK (shm_map (id, obj) == obj, "shm_map \"big\"");
+  for (i = 0; i < PAGE_CNT; i++)
+    obj[i * PAGE_SIZE] = (char) i;
+  msg ("wrote every page");
+
+  child = fork ("child");
+  if (child == 0)
+    {
+      for (i = 0; i < PAGE_CNT; i++)
+        {
+          if (obj[i * PAGE_SIZE] != (char) i)
+            fail ("child read bad data from page %zu", i);
+          obj[i * PAGE_SIZE] = (char) ~i;
+        }
+      msg ("child read and rewrote every page");
+      return;
+    }
+  wait (child);
+  for (i = 0; i < PAGE_CNT; i++)
+    if (obj[i * PAGE_SIZE] != (char) ~i)
+      fail ("parent read bad data from page %zu", i);
+  msg ("parent sees every page the child wrote");
+}
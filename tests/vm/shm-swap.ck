@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(shm-swap) begin
+(shm-swap) shm_open "big"
+(shm-swap) shm_map "big"
+(shm-swap) wrote every page
+(shm-swap) child read and rewrote every page
+(shm-swap) end
+(shm-swap) parent sees every page the child wrote
+(shm-swap) end
+EOF
+pass;
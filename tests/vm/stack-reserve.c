@@ -0,0 +1,42 @@
+/* Reserves 128 kB of stack, grows the stack within the reservation,
+   then grows it past the reservation.  The second growth would fit
+   under the default 1 MB limit, so the process must be killed only
+   because of the smaller reservation. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define KB 1024
+
+/* Largest stack reservation the kernel accepts. */
+#define STACK_LIMIT_MAX (64 * KB * KB)
+
+/* Moves the stack pointer SIZE bytes down and touches every page
+   from the new stack pointer up. */
+static void __attribute__ ((noinline))
+use_stack (size_t size)
+{
+  char buf[size];
+  volatile char *p = buf;
+  size_t i;
+
+  for (i = 0; i < size; i += PAGE_SIZE)
+    p[i] = 1;
+}
+
+void
+test_main (void)
+{
+  CHECK (!stack_reserve (STACK_LIMIT_MAX + PAGE_SIZE, 0),
+         "reserving more than the maximum fails");
+  CHECK (stack_reserve (128 * KB, 0), "reserve 128 kB of stack");
+  msg ("grow the stack by 64 kB");
+  use_stack (64 * KB);
+  CHECK (!stack_reserve (16 * KB, 0),
+         "reserving less than the mapped stack fails");
+  msg ("grow the stack by 192 kB");
+  use_stack (192 * KB);
+  fail ("grew the stack past the reservation");
+}
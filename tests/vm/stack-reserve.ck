@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(stack-reserve) begin
+(stack-reserve) reserving more than the maximum fails
+(stack-reserve) reserve 128 kB of stack
+(stack-reserve) grow the stack by 64 kB
+(stack-reserve) reserving less than the mapped stack fails
+(stack-reserve) grow the stack by 192 kB
+stack-reserve: exit(-1)
+EOF
+pass;
@@ -0,0 +1,71 @@
+/* Takes snapshots of the VM counters around known work: reading a
+   mapped file, touching a fresh shared memory object, and cycling a
+   buffer through swap under a resident set cap.  Checks that each
+   counter moves by at least the amount the work accounts for. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define FILE_PAGES 3            /* Pages of "small.txt". */
+#define SHM_PAGES 4
+#define BUF_PAGES 64
+#define RSS_CAP 16
+
+static char buf[BUF_PAGES * PAGE_SIZE];
+
+/* Fails unless counter FIELD rose by at least MIN from OLD to NEW. */
+#define CHECK_RISE(OLD, NEW, FIELD, MIN)                                \
+        do                                                              \
+          {                                                             \
+            if ((NEW).FIELD - (OLD).FIELD < (MIN))                      \
+              fail (#FIELD " rose by %llu, expected at least %d",       \
+                    (NEW).FIELD - (OLD).FIELD, (MIN));                  \
+            msg (#FIELD " rose by at least %d", (MIN));                 \
+          }                                                             \
+        while (0)
+
+void
+test_main (void)
+{
+  volatile char *file = (char *) 0x10000000;
+  char *shm = (char *) 0x20000000;
+  struct vmstat before, after;
+  int handle, id;
+  size_t i;
+
+  CHECK ((handle = open ("small.txt")) > 1, "open \"small.txt\"");
+  CHECK (mmap ((void *) file, FILE_PAGES * PAGE_SIZE, 0, handle, 0) == file,
+         "mmap \"small.txt\"");
+  CHECK ((id = shm_open ("obj", SHM_PAGES * PAGE_SIZE)) >= 0,
+         "shm_open \"obj\"");
+  CHECK (shm_map (id, shm) == shm, "shm_map \"obj\"");
+
+  CHECK (vmstat (&before), "vmstat");
+  for (i = 0; i < FILE_PAGES; i++)
+    (void) file[i * PAGE_SIZE];
+  for (i = 0; i < SHM_PAGES; i++)
+    shm[i * PAGE_SIZE] = 1;
+  CHECK (vmstat (&after), "vmstat");
+  CHECK_RISE (before, after, major_faults, FILE_PAGES);
+  CHECK_RISE (before, after, file_resident, FILE_PAGES);
+  CHECK_RISE (before, after, minor_faults, SHM_PAGES);
+  CHECK_RISE (before, after, anon_resident, SHM_PAGES);
+
+  CHECK (rss_limit (RSS_CAP * PAGE_SIZE), "cap the resident set at %d pages",
+         RSS_CAP);
+  before = after;
+  for (i = 0; i < BUF_PAGES; i++)
+    buf[i * PAGE_SIZE] = i;
+  CHECK (vmstat (&after), "vmstat");
+  CHECK_RISE (before, after, swap_outs, BUF_PAGES - RSS_CAP);
+  CHECK_RISE (before, after, evict_local, BUF_PAGES - RSS_CAP);
+
+  before = after;
+  for (i = 0; i < BUF_PAGES; i++)
+    if (buf[i * PAGE_SIZE] != (char) i)
+      fail ("page %zu has the wrong data", i);
+  CHECK (vmstat (&after), "vmstat");
+  CHECK_RISE (before, after, swap_ins, BUF_PAGES - RSS_CAP);
+}
@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(vmstat-count) begin
+(vmstat-count) open "small.txt"
+(vmstat-count) mmap "small.txt"
+(vmstat-count) shm_open "obj"
+(vmstat-count) shm_map "obj"
+(vmstat-count) vmstat
+(vmstat-count) vmstat
+(vmstat-count) major_faults rose by at least 3
+(vmstat-count) file_resident rose by at least 3
+(vmstat-count) minor_faults rose by at least 4
+(vmstat-count) anon_resident rose by at least 4
+(vmstat-count) cap the resident set at 16 pages
+(vmstat-count) vmstat
+(vmstat-count) swap_outs rose by at least 48
+(vmstat-count) evict_local rose by at least 48
+(vmstat-count) vmstat
+(vmstat-count) swap_ins rose by at least 48
+(vmstat-count) end
+EOF
+pass;
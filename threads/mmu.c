@@ -1,12 +1,126 @@
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
 #include "intrinsic.h"
+#include "hash.h"
+
+/* Leaf page tables shared between page map level 4s by fork.
+ * Both page directory entries point at the same table with PTE_W
+ * cleared and PTE_SHARED set, so the whole 2 MiB range is read-only
+ * until one side writes to it and takes its own copy.  PT_SHARES
+ * counts how many directories still use each table; a table that
+ * has no entry left is owned by a single directory. */
+struct pt_share {
+	struct hash_elem elem;
+	uint64_t *pt;           /* Shared page table. */
+	unsigned cnt;           /* Page directory entries pointing at PT. */
+};
+
+static struct hash pt_shares;
+static struct lock pt_share_lock;
+
+static uint64_t
+pt_share_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct pt_share *share = hash_entry (e, struct pt_share, elem);
+	return hash_bytes (&share->pt, sizeof share->pt);
+}
+
+static bool
+pt_share_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct pt_share, elem)->pt
+		< hash_entry (b, struct pt_share, elem)->pt;
+}
+
+/* Returns the share record of PT, or a null pointer if PT has a
+ * single owner.  Caller must hold pt_share_lock. */
+static struct pt_share *
+pt_share_find (uint64_t *pt) {
+	struct pt_share key;
+	struct hash_elem *e;
+
+	key.pt = pt;
+	e = hash_find (&pt_shares, &key.elem);
+	return e != NULL ? hash_entry (e, struct pt_share, elem) : NULL;
+}
+
+/* Process-context identifiers.  With CR4.PCIDE set, the CPU tags
+ * TLB entries with the PCID held in the low bits of CR3, so that
+ * switching between a few processes keeps their translations.
+ * A page map level 4 is hashed by its frame onto one of PCID_CNT - 1
+ * PCIDs; PCID 0 belongs to base_pml4.  PCID_OWNER records which
+ * pml4 the entries under each PCID came from.  The next activation
+ * flushes the PCID if it changes owner, or if the owner's tables
+ * were changed while it was not loaded (PCID_STALE). */
+#define PCID_CNT 4096
+#define CR3_NOFLUSH (1ULL << 63)
+
+static bool pcid_enabled;
+static uint64_t *pcid_owner[PCID_CNT];
+static bool pcid_stale[PCID_CNT];
+
+static unsigned
+pml4_pcid (uint64_t *pml4) {
+	if (pml4 == base_pml4)
+		return 0;
+	return (vtop (pml4) >> PGBITS) % (PCID_CNT - 1) + 1;
+}
+
+/* Returns true if the CPU is running on PML4. */
+static bool
+pml4_is_active (uint64_t *pml4) {
+	return PTE_ADDR (rcr3 ()) == vtop (pml4);
+}
+
+/* Drops every TLB entry cached from PML4, now if PML4 is loaded or
+ * else on its next activation. */
+static void
+pml4_flush (uint64_t *pml4) {
+	unsigned pcid;
+
+	if (pml4_is_active (pml4))
+		lcr3 (rcr3 ());
+	else if (pcid_enabled) {
+		pcid = pml4_pcid (pml4);
+		if (pcid_owner[pcid] == pml4)
+			pcid_stale[pcid] = true;
+	}
+}
+
+/* Drops the TLB entry for VA cached from PML4. */
+static void
+pml4_invalidate (uint64_t *pml4, uint64_t va) {
+	if (pml4_is_active (pml4))
+		invlpg (va);
+	else
+		pml4_flush (pml4);
+}
+
+/* Initializes page table sharing, and turns on process-context
+ * identifiers if the CPU has them. */
+void
+mmu_init (void) {
+	uint32_t eax, ebx, ecx, edx;
+
+	hash_init (&pt_shares, pt_share_hash, pt_share_less, NULL);
+	lock_init (&pt_share_lock);
+
+	/* CR3 holds base_pml4 with PCID 0 here, as CR4.PCIDE requires. */
+	cpuid (1, &eax, &ebx, &ecx, &edx);
+	if (ecx & CPUID_1_ECX_PCID) {
+		lcr4 (rcr4 () | CR4_PCIDE);
+		pcid_owner[0] = base_pml4;
+		pcid_enabled = true;
+	}
+}
 
 static uint64_t *
 pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
@@ -122,7 +236,7 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if ((((uint64_t) pte) & PTE_P) && !(pdp[i] & PTE_PS))
 			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
 					pml4_index, pdp_index, i))
 				return false;
@@ -143,7 +257,8 @@ pdp_for_each (uint64_t *pdp,
 	return true;
 }
 
-/* Apply FUNC to each available pte entries including kernel's. */
+/* Apply FUNC to each available pte entries including kernel's.
+ * Kernel memory mapped by 2 MiB pages has no PTEs to visit. */
 bool
 pml4_for_each (uint64_t *pml4, pte_for_each_func *func, void *aux) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
@@ -157,20 +272,55 @@ pml4_for_each (uint64_t *pml4, pte_for_each_func *func, void *aux) {
 
 static void
 pt_destroy (uint64_t *pt) {
+#ifndef VM
+	/* With VM, frames belong to the pages in the supplemental page
+	 * table, which free them (or leave them to a fork sibling). */
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pt[i]);
 		if (((uint64_t) pte) & PTE_P)
 			palloc_free_page ((void *) PTE_ADDR (pte));
 	}
+#endif
 	palloc_free_page ((void *) pt);
 }
 
+/* Drops one page directory's reference to the shared page table
+ * PT.  Returns true if another directory still uses PT.  Caller
+ * must hold pt_share_lock. */
+static bool
+pt_share_drop (uint64_t *pt) {
+	struct pt_share *share = pt_share_find (pt);
+
+	if (share == NULL)
+		return false;
+	if (--share->cnt == 1) {
+		hash_delete (&pt_shares, &share->elem);
+		free (share);
+	}
+	return true;
+}
+
+/* Like pt_share_drop(), but takes pt_share_lock itself. */
+static bool
+pt_share_put (uint64_t *pt) {
+	bool in_use;
+
+	lock_acquire (&pt_share_lock);
+	in_use = pt_share_drop (pt);
+	lock_release (&pt_share_lock);
+	return in_use;
+}
+
 static void
 pgdir_destroy (uint64_t *pdp) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if (((uint64_t) pte) & PTE_P) {
+			if ((pdp[i] & PTE_SHARED)
+					&& pt_share_put (ptov (PTE_ADDR (pdp[i]))))
+				continue;
 			pt_destroy (PTE_ADDR (pte));
+		}
 	}
 	palloc_free_page ((void *) pdp);
 }
@@ -196,14 +346,246 @@ pml4_destroy (uint64_t *pml4) {
 	uint64_t *pdpe = ptov ((uint64_t *) pml4[0]);
 	if (((uint64_t) pdpe) & PTE_P)
 		pdpe_destroy ((void *) PTE_ADDR (pdpe));
+
+	/* A later pml4 in the same frame must not inherit our TLB entries. */
+	if (pcid_owner[pml4_pcid (pml4)] == pml4)
+		pcid_owner[pml4_pcid (pml4)] = NULL;
 	palloc_free_page ((void *) pml4);
 }
 
+/* Makes the child page map level 4 DST share every user page
+ * table of SRC instead of copying their entries, so that fork
+ * costs one step per 2 MiB of address space rather than one per
+ * page.  Both directories lose write access to the shared ranges.
+ * Returns false if memory allocation failed; DST may then hold
+ * part of the mappings and must be destroyed by the caller. */
+bool
+pml4_share_user (uint64_t *dst, uint64_t *src) {
+	uint64_t *src_pdpt, *dst_pdpt;
+
+	if (!(src[0] & PTE_P))
+		return true;
+	if (!(dst[0] & PTE_P)) {
+		uint64_t *new_page = palloc_get_page (PAL_ZERO);
+		if (new_page == NULL)
+			return false;
+		dst[0] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+	}
+	src_pdpt = ptov (PTE_ADDR (src[0]));
+	dst_pdpt = ptov (PTE_ADDR (dst[0]));
+
+	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
+		uint64_t *src_pd, *dst_pd;
+
+		if (!(src_pdpt[i] & PTE_P))
+			continue;
+		if (!(dst_pdpt[i] & PTE_P)) {
+			uint64_t *new_page = palloc_get_page (PAL_ZERO);
+			if (new_page == NULL)
+				return false;
+			dst_pdpt[i] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+		}
+		src_pd = ptov (PTE_ADDR (src_pdpt[i]));
+		dst_pd = ptov (PTE_ADDR (dst_pdpt[i]));
+
+		lock_acquire (&pt_share_lock);
+		for (unsigned j = 0; j < PGSIZE / sizeof(uint64_t *); j++) {
+			uint64_t *pt;
+			struct pt_share *share;
+
+			if (!(src_pd[j] & PTE_P) || (dst_pd[j] & PTE_P))
+				continue;
+			pt = ptov (PTE_ADDR (src_pd[j]));
+			share = pt_share_find (pt);
+			if (share == NULL) {
+				share = malloc (sizeof *share);
+				if (share == NULL) {
+					lock_release (&pt_share_lock);
+					return false;
+				}
+				share->pt = pt;
+				share->cnt = 1;
+				hash_insert (&pt_shares, &share->elem);
+			}
+			share->cnt++;
+			src_pd[j] = (src_pd[j] & ~(uint64_t) PTE_W) | PTE_SHARED;
+			dst_pd[j] = src_pd[j];
+		}
+		lock_release (&pt_share_lock);
+	}
+	pml4_flush (src);
+	return true;
+}
+
+/* Returns the address of the page directory entry for VA in
+ * PML4.  If VA has no page directory, one is created when CREATE
+ * is true; otherwise a null pointer is returned. */
+uint64_t *
+pml4_pde_walk (uint64_t *pml4, const uint64_t va, int create) {
+	uint64_t *pdpt, *pd;
+
+	if (!(pml4[PML4 (va)] & PTE_P)) {
+		uint64_t *new_page = create ? palloc_get_page (PAL_ZERO) : NULL;
+		if (new_page == NULL)
+			return NULL;
+		pml4[PML4 (va)] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+	}
+	pdpt = ptov (PTE_ADDR (pml4[PML4 (va)]));
+	if (!(pdpt[PDPE (va)] & PTE_P)) {
+		uint64_t *new_page = create ? palloc_get_page (PAL_ZERO) : NULL;
+		if (new_page == NULL)
+			return NULL;
+		pdpt[PDPE (va)] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+	}
+	pd = ptov (PTE_ADDR (pdpt[PDPE (va)]));
+	return &pd[PDX (va)];
+}
+
+/* If the page table for UPAGE in PML4 is shared, gives PML4 a
+ * private copy of it.  Every present entry of the table loses
+ * write access, since the frames behind it are still shared; the
+ * caller restores it page by page.  Returns false only if memory
+ * allocation failed. */
+bool
+pml4_unshare (uint64_t *pml4, const void *upage) {
+	uint64_t *pde = pml4_pde_walk (pml4, (uint64_t) upage, false);
+	uint64_t *pt;
+	struct pt_share *share;
+
+	if (pde == NULL || !(*pde & PTE_SHARED))
+		return true;
+
+	/* An evictor may be unsharing the same PML4 on its owner's
+	 * behalf, so look again once no one else can. */
+	lock_acquire (&pt_share_lock);
+	pde = pml4_pde_walk (pml4, (uint64_t) upage, false);
+	if (pde == NULL || !(*pde & PTE_SHARED)) {
+		lock_release (&pt_share_lock);
+		return true;
+	}
+	pt = ptov (PTE_ADDR (*pde));
+	share = pt_share_find (pt);
+	if (share != NULL) {
+		uint64_t *copy = palloc_get_page (0);
+		if (copy == NULL) {
+			lock_release (&pt_share_lock);
+			return false;
+		}
+		for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
+			if (pt[i] & PTE_P)
+				pt[i] &= ~(uint64_t) PTE_W;
+		memcpy (copy, pt, PGSIZE);
+		if (--share->cnt == 1) {
+			hash_delete (&pt_shares, &share->elem);
+			free (share);
+		}
+		pt = copy;
+	}
+	*pde = vtop (pt) | ((*pde & PTE_FLAGS & ~(uint64_t) PTE_SHARED) | PTE_W);
+	lock_release (&pt_share_lock);
+
+	pml4_flush (pml4);
+	return true;
+}
+
+/* Page-table pages given back by pml4_reclaim(). */
+static size_t reclaimed_pt_cnt;
+static size_t reclaimed_pd_cnt;
+
+/* Returns true if no entry of TABLE is present. */
+static bool
+table_is_empty (const uint64_t *table) {
+	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
+		if (table[i] & PTE_P)
+			return false;
+	return true;
+}
+
+/* Frees the page tables, and then the page directories, of PML4
+ * that no longer map anything after [UPAGE, UPAGE + SIZE) was
+ * unmapped or evicted.  Without this they would stay allocated
+ * until the process exits.  Tables shared with a fork sibling are
+ * left to pml4_unshare() and pml4_destroy().
+ *
+ * PML4 must be the running process's own: another process may be
+ * inside pml4_set_page() holding a pointer into a table that is
+ * still empty, so eviction on its behalf leaves its tables alone. */
+void
+pml4_reclaim (uint64_t *pml4, const void *upage, size_t size) {
+	const uint64_t pd_span = 1UL << PDPESHIFT;
+	uint64_t start = (uint64_t) upage;
+	uint64_t end = start + size;
+	uint64_t freed_va = 0;
+	bool freed = false;
+	uint64_t va;
+
+	ASSERT (is_user_vaddr (upage));
+	ASSERT (pml4_is_active (pml4));
+
+	for (va = start & ~(LARGE_PGSIZE - 1); va < end; va += LARGE_PGSIZE) {
+		uint64_t *pde = pml4_pde_walk (pml4, va, false);
+
+		if (pde == NULL || !(*pde & PTE_P) || (*pde & PTE_SHARED)
+				|| !table_is_empty (ptov (PTE_ADDR (*pde))))
+			continue;
+		palloc_free_page (ptov (PTE_ADDR (*pde)));
+		*pde = 0;
+		reclaimed_pt_cnt++;
+		freed_va = va;
+		freed = true;
+	}
+
+	for (va = start & ~(pd_span - 1); va < end; va += pd_span) {
+		uint64_t *pdpt, *pdpe;
+
+		if (!(pml4[PML4 (va)] & PTE_P))
+			continue;
+		pdpt = ptov (PTE_ADDR (pml4[PML4 (va)]));
+		pdpe = &pdpt[PDPE (va)];
+		if (!(*pdpe & PTE_P) || !table_is_empty (ptov (PTE_ADDR (*pdpe))))
+			continue;
+		palloc_free_page (ptov (PTE_ADDR (*pdpe)));
+		*pdpe = 0;
+		reclaimed_pd_cnt++;
+		freed_va = va;
+		freed = true;
+	}
+
+	/* invlpg also drops the paging-structure caches of the PCID. */
+	if (freed)
+		pml4_invalidate (pml4, freed_va);
+}
+
+/* Prints page-table reclaim statistics. */
+void
+mmu_print_stats (void) {
+	printf ("Paging: %zu page tables, %zu page directories reclaimed\n",
+			reclaimed_pt_cnt, reclaimed_pd_cnt);
+}
+
 /* Loads page directory PD into the CPU's page directory base
  * register. */
 void
 pml4_activate (uint64_t *pml4) {
-	lcr3 (vtop (pml4 ? pml4 : base_pml4));
+	unsigned pcid;
+
+	if (pml4 == NULL)
+		pml4 = base_pml4;
+	if (!pcid_enabled) {
+		lcr3 (vtop (pml4));
+		return;
+	}
+
+	/* Keep the TLB entries tagged with PML4's PCID unless they may
+	 * belong to another pml4 or be out of date. */
+	pcid = pml4_pcid (pml4);
+	if (pcid_owner[pcid] == pml4 && !pcid_stale[pcid])
+		lcr3 (vtop (pml4) | pcid | CR3_NOFLUSH);
+	else {
+		pcid_owner[pcid] = pml4;
+		pcid_stale[pcid] = false;
+		lcr3 (vtop (pml4) | pcid);
+	}
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -223,7 +605,7 @@ pml4_get_page (uint64_t *pml4, const void *uaddr) {
 
 /* Adds a mapping in page map level 4 PML4 from user virtual page
  * UPAGE to the physical frame identified by kernel virtual address KPAGE.
- * UPAGE must not already be mapped. KPAGE should probably be a page obtained
+ * An existing mapping of UPAGE is replaced. KPAGE should probably be a page obtained
  * from the user pool with palloc_get_page().
  * If WRITABLE is true, the new page is read/write;
  * otherwise it is read-only.
@@ -236,17 +618,96 @@ pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 	ASSERT (is_user_vaddr (upage));
 	ASSERT (pml4 != base_pml4);
 
+	if (!pml4_unshare (pml4, upage))
+		return false;
+
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) upage, 1);
 
-	if (pte)
+	if (pte) {
+		bool was_present = (*pte & PTE_P) != 0;
 		*pte = vtop (kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+		if (was_present)
+			pml4_invalidate (pml4, (uint64_t) upage);
+	}
 	return pte != NULL;
 }
 
+/* Points the present mapping of UPAGE in PML4 at the frame KPAGE,
+ * keeping its permission and status bits, after the contents were
+ * copied there.  The page table must not be shared.  Returns false
+ * if UPAGE is not mapped. */
+bool
+pml4_move_page (uint64_t *pml4, void *upage, void *kpage) {
+	uint64_t *pte;
+	ASSERT (pg_ofs (upage) == 0);
+	ASSERT (pg_ofs (kpage) == 0);
+	ASSERT (is_user_vaddr (upage));
+
+	pte = pml4e_walk (pml4, (uint64_t) upage, false);
+	if (pte == NULL || (*pte & PTE_P) == 0)
+		return false;
+	*pte = vtop (kpage) | (*pte & PTE_FLAGS);
+	pml4_invalidate (pml4, (uint64_t) upage);
+	return true;
+}
+
+/* Gives the present mapping of UPAGE in PML4 write access again,
+ * keeping its other bits, after pml4_unshare() took it away from
+ * the whole table.  Unlike pml4_set_page(), this keeps the dirty
+ * bit.  Returns false if UPAGE is not mapped or memory is short. */
+bool
+pml4_make_writable (uint64_t *pml4, void *upage) {
+	uint64_t *pte;
+	ASSERT (pg_ofs (upage) == 0);
+	ASSERT (is_user_vaddr (upage));
+
+	if (!pml4_unshare (pml4, upage))
+		return false;
+	pte = pml4e_walk (pml4, (uint64_t) upage, false);
+	if (pte == NULL || (*pte & PTE_P) == 0)
+		return false;
+	if ((*pte & PTE_W) == 0) {
+		*pte |= PTE_W;
+		pml4_invalidate (pml4, (uint64_t) upage);
+	}
+	return true;
+}
+
+/* Drops PML4's use of the shared page table that maps UPAGE, for
+ * when pml4_unshare() could not allocate a copy of it.  The other
+ * pages in the table's 2 MiB range lose their mappings in PML4 as
+ * well; their frames stay with their pages and the next access
+ * maps them again.  Returns false, keeping the table, if no other
+ * directory uses it any more and it is PML4's own. */
+static bool
+pml4_detach (uint64_t *pml4, const void *upage) {
+	uint64_t *pde;
+
+	lock_acquire (&pt_share_lock);
+	pde = pml4_pde_walk (pml4, (uint64_t) upage, false);
+	if (pde == NULL || !(*pde & PTE_SHARED)) {
+		/* Unshared meanwhile by an evictor. */
+		lock_release (&pt_share_lock);
+		return false;
+	}
+	if (!pt_share_drop (ptov (PTE_ADDR (*pde)))) {
+		*pde = (*pde & ~(uint64_t) PTE_SHARED) | PTE_W;
+		lock_release (&pt_share_lock);
+		return false;
+	}
+	*pde = 0;
+	lock_release (&pt_share_lock);
+	pml4_flush (pml4);
+	return true;
+}
+
 /* Marks user virtual page UPAGE "not present" in page
  * directory PD.  Later accesses to the page will fault.  Other
  * bits in the page table entry are preserved.
- * UPAGE need not be mapped. */
+ * UPAGE need not be mapped.  If UPAGE lies in a page table shared
+ * with a fork sibling and memory is too short to copy it, PML4
+ * lets go of the whole table instead (see pml4_detach()); callers
+ * that clear another process's PML4 unshare it beforehand. */
 void
 pml4_clear_page (uint64_t *pml4, void *upage) {
 	uint64_t *pte;
@@ -256,9 +717,11 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
 	pte = pml4e_walk (pml4, (uint64_t) upage, false);
 
 	if (pte != NULL && (*pte & PTE_P) != 0) {
+		if (!pml4_unshare (pml4, upage) && pml4_detach (pml4, upage))
+			return;
+		pte = pml4e_walk (pml4, (uint64_t) upage, false);
 		*pte &= ~PTE_P;
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) upage);
+		pml4_invalidate (pml4, (uint64_t) upage);
 	}
 }
 
@@ -283,8 +746,7 @@ pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
 		else
 			*pte &= ~(uint32_t) PTE_D;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		pml4_invalidate (pml4, (uint64_t) vpage);
 	}
 }
 
@@ -309,7 +771,6 @@ pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 		else
 			*pte &= ~(uint32_t) PTE_A;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		pml4_invalidate (pml4, (uint64_t) vpage);
 	}
 }
@@ -9,6 +9,7 @@
 #include <string.h>
 #include "threads/init.h"
 #include "threads/loader.h"
+#include "threads/malloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
@@ -38,10 +39,14 @@ static struct pool kernel_pool, user_pool;
 
 /* Maximum number of pages to put in user pool. */
 size_t user_page_limit = SIZE_MAX;
+
+/* Moves user pages out of the way for compaction; set by the VM. */
+static palloc_migrate_func *migrate_page;
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static void *compact_pool (struct pool *, size_t page_cnt);
 
 /* multiboot info */
 struct multiboot_info {
@@ -256,9 +261,12 @@ palloc_init (void) {
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
    If PAL_USER is set, the pages are obtained from the user pool,
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
-   then the pages are filled with zeros.  If too few pages are
-   available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
+   then the pages are filled with zeros.  If PAL_ANY is set and
+   the kernel pool has no run of PAGE_CNT free pages, the pages
+   come from the user pool instead, which is compacted if it is
+   fragmented.  If too few pages are available, returns a null
+   pointer, unless PAL_ASSERT is set in FLAGS, in which case the
+   kernel panics. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
@@ -270,6 +278,10 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 
 	if (page_idx != BITMAP_ERROR)
 		pages = pool->base + PGSIZE * page_idx;
+	else if (pool == &user_pool && page_cnt > 1 && migrate_page != NULL)
+		pages = compact_pool (pool, page_cnt);
+	else if (flags & PAL_ANY)
+		return palloc_get_multiple ((flags & ~PAL_ANY) | PAL_USER, page_cnt);
 	else
 		pages = NULL;
 
@@ -328,6 +340,86 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Stores the numbers of allocated and free pages in the user pool
+   in *USED_CNT and *FREE_CNT.  Call with interrupts off for a
+   consistent view. */
+void
+palloc_user_usage (size_t *used_cnt, size_t *free_cnt) {
+	size_t size = bitmap_size (user_pool.used_map);
+
+	*free_cnt = bitmap_count (user_pool.used_map, 0, size, false);
+	*used_cnt = size - *free_cnt;
+}
+
+/* Registers MIGRATE as the way to move user pages when a request
+   for several contiguous user pages finds the pool fragmented. */
+void
+palloc_set_migrator (palloc_migrate_func *migrate) {
+	migrate_page = migrate;
+}
+
+/* Builds a run of PAGE_CNT free pages in POOL by migrating the pages
+   that are in the way, and returns it allocated, or a null pointer
+   if that is impossible.  The window with the fewest used pages is
+   chosen, and its free pages are reserved first so that nothing else
+   takes them while the used ones are moved out. */
+static void *
+compact_pool (struct pool *pool, size_t page_cnt) {
+	size_t pool_size = bitmap_size (pool->used_map);
+	size_t best_idx = BITMAP_ERROR, best_used = SIZE_MAX;
+	size_t used = 0, free_cnt, i;
+	bool *reserved;
+
+	if (page_cnt > pool_size)
+		return NULL;
+	reserved = malloc (page_cnt * sizeof *reserved);
+	if (reserved == NULL)
+		return NULL;
+
+	lock_acquire (&pool->lock);
+	free_cnt = bitmap_count (pool->used_map, 0, pool_size, false);
+	for (i = 0; i < pool_size; i++) {
+		used += bitmap_test (pool->used_map, i);
+		if (i >= page_cnt)
+			used -= bitmap_test (pool->used_map, i - page_cnt);
+		if (i + 1 >= page_cnt && used < best_used) {
+			best_used = used;
+			best_idx = i + 1 - page_cnt;
+		}
+	}
+	/* The pages moved out need somewhere to go. */
+	if (best_idx == BITMAP_ERROR || free_cnt < page_cnt) {
+		lock_release (&pool->lock);
+		free (reserved);
+		return NULL;
+	}
+	for (i = 0; i < page_cnt; i++) {
+		reserved[i] = !bitmap_test (pool->used_map, best_idx + i);
+		if (reserved[i])
+			bitmap_mark (pool->used_map, best_idx + i);
+	}
+	lock_release (&pool->lock);
+
+	for (i = 0; i < page_cnt; i++) {
+		if (reserved[i])
+			continue;
+		if (!migrate_page (pool->base + PGSIZE * (best_idx + i)))
+			break;
+		reserved[i] = true;
+	}
+
+	if (i < page_cnt) {
+		/* Give back what we took; moved pages stay where they went. */
+		for (i = 0; i < page_cnt; i++)
+			if (reserved[i])
+				palloc_free_page (pool->base + PGSIZE * (best_idx + i));
+		free (reserved);
+		return NULL;
+	}
+	free (reserved);
+	return pool->base + PGSIZE * best_idx;
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
@@ -32,26 +32,169 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
-/* One semaphore in a list. */
+/* One semaphore in a condition's waiters. */
 struct semaphore_elem {
-	struct list_elem elem;              /* List element. */
+	struct heap_elem elem;              /* Heap element. */
 	struct semaphore semaphore;         /* This semaphore. */
+	struct thread *thread;              /* Thread waiting on it. */
+	uint64_t seq;                       /* Orders equal priorities. */
 };
 
-bool compare_sema_priority (const struct list_elem *a,
- const struct list_elem *b, void *aux){
-	struct semaphore_elem *sema1 = list_entry(a,struct semaphore_elem, elem);
-	struct semaphore_elem *sema2 = list_entry(b,struct semaphore_elem, elem);
-	// struct list * a1 = &(sema1->semaphore.waiters);
-	// struct list * a2 = &(sema2->semaphore.waiters);
-	return list_entry (list_begin(&(sema1->semaphore.waiters)), struct thread, elem)->priority
-	 > list_entry (list_begin(&(sema2->semaphore.waiters)), struct thread, elem)->priority;
+/* Stamps waiters so that equal priorities are served first come,
+   first served. */
+static uint64_t next_wait_seq;
+
+static void lock_donate (struct lock *);
+static void rwlock_donate (struct rwlock *);
+
+/* Waiters heaps: higher priority first, then earlier arrival. */
+static bool
+waiter_less (const struct heap_elem *a, const struct heap_elem *b,
+		void *aux UNUSED) {
+	const struct thread *ta = heap_entry (a, struct thread, wait_elem);
+	const struct thread *tb = heap_entry (b, struct thread, wait_elem);
+
+	if (ta->priority != tb->priority)
+		return ta->priority > tb->priority;
+	return ta->wait_seq < tb->wait_seq;
+}
+
+static bool
+sema_elem_less (const struct heap_elem *a, const struct heap_elem *b,
+		void *aux UNUSED) {
+	const struct semaphore_elem *sa = heap_entry (a, struct semaphore_elem, elem);
+	const struct semaphore_elem *sb = heap_entry (b, struct semaphore_elem, elem);
+
+	if (sa->thread->priority != sb->thread->priority)
+		return sa->thread->priority > sb->thread->priority;
+	return sa->seq < sb->seq;
+}
+
+/* Returns the priority of the best thread donating through D,
+   or -1 if none waits. */
+static int
+donation_priority (const struct donation *d) {
+	int priority = -1;
+	int i;
+
+	for (i = 0; i < 2 && d->waiters[i] != NULL; i++)
+		if (!heap_empty (d->waiters[i])) {
+			int p = heap_entry (heap_top (d->waiters[i]), struct thread,
+					wait_elem)->priority;
+			if (p > priority)
+				priority = p;
+		}
+	return priority;
 }
 
-bool compare_donation_priority (const struct list_elem *a,
-const struct list_elem *b, void *aux){
-	return list_entry (a, struct thread, d_elem)->priority
-	 > list_entry (b, struct thread, d_elem)->priority;
+/* Donations heaps: the donation with the best waiter first. */
+bool
+donation_less (const struct heap_elem *a, const struct heap_elem *b,
+		void *aux UNUSED) {
+	return donation_priority (heap_entry (a, struct donation, elem))
+		> donation_priority (heap_entry (b, struct donation, elem));
+}
+
+/* Makes D a donation from the threads in waiter heaps A and B,
+   either of which may be null. */
+static void
+donation_init (struct donation *d, struct heap *a, struct heap *b) {
+	d->waiters[0] = a;
+	d->waiters[1] = b;
+	d->active = false;
+}
+
+/* Returns the higher of T's own priority and the best donation
+   it receives. */
+static int
+donated_priority (struct thread *t) {
+	int priority = t->original_priority;
+
+	if (!heap_empty (&t->donations)) {
+		struct donation *d = heap_entry (heap_top (&t->donations),
+				struct donation, elem);
+		if (donation_priority (d) > priority)
+			priority = donation_priority (d);
+	}
+	return priority;
+}
+
+/* Updates donation D to DONEE after a waiter arrived or a
+   waiter's priority changed.  DONEE's new priority moves on down
+   the chain of locks through thread_change_priority(). */
+static void
+donate (struct donation *d, struct thread *donee) {
+	int priority;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (donation_priority (d) < 0)
+		return;
+	if (d->active)
+		heap_update (&donee->donations, &d->elem);
+	else {
+		heap_push (&donee->donations, &d->elem);
+		d->active = true;
+	}
+
+	/*기부받은 우선순위 중 가장 높은 우선순위로 donee의 우선순위를 업데이트*/
+	priority = donated_priority (donee);
+	if (priority != donee->priority)
+		thread_change_priority (donee, priority);
+}
+
+/* Takes donation D back from DONEE.  DONEE's priority is left
+   for the caller to update. */
+static void
+undonate (struct donation *d, struct thread *donee) {
+	if (d->active) {
+		heap_remove (&donee->donations, &d->elem);
+		d->active = false;
+	}
+}
+
+/* Adds the current thread to WAITERS.  Unless it already waits in
+   another heap that must follow its priority, as in cond_wait(),
+   WAITERS becomes that heap. */
+static void
+waiters_push (struct heap *waiters) {
+	struct thread *curr = thread_current ();
+
+	curr->wait_seq = next_wait_seq++;
+	heap_push (waiters, &curr->wait_elem);
+	if (curr->wait_heap == NULL) {
+		curr->wait_heap = waiters;
+		curr->wait_node = &curr->wait_elem;
+	}
+}
+
+/* Removes and returns the best thread in WAITERS. */
+static struct thread *
+waiters_pop (struct heap *waiters) {
+	struct thread *t = heap_entry (heap_pop (waiters), struct thread, wait_elem);
+
+	if (t->wait_heap == waiters)
+		t->wait_heap = NULL;
+	return t;
+}
+
+/* Called by thread_change_priority(), with interrupts off, after
+   the priority of T, which waits in T->wait_heap, has gone up if
+   RAISED or down otherwise.  Moves T within that heap and, if T
+   waits for a lock or rwlock, passes the new priority on to its
+   holders. */
+void
+synch_priority_changed (struct thread *t, bool raised) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (raised)
+		heap_raise (t->wait_heap, t->wait_node);
+	else
+		heap_update (t->wait_heap, t->wait_node);
+	if (t->wait_on_lock != NULL)
+		lock_donate (t->wait_on_lock);
+	else if (t->wait_on_rwlock != NULL)
+		rwlock_donate (t->wait_on_rwlock);
 }
 
 
@@ -69,7 +212,7 @@ sema_init (struct semaphore *sema, unsigned value) {
 	ASSERT (sema != NULL);
 
 	sema->value = value;
-	list_init (&sema->waiters);
+	heap_init (&sema->waiters, waiter_less, NULL);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -89,8 +232,7 @@ sema_down (struct semaphore *sema) {//P(Wait):자원요청시 실행하는 연
 
 	old_level = intr_disable ();//인터럽트 비활성화
 	while (sema->value == 0) {
-		//list_push_back (&sema->waiters, &thread_current ()->elem);//대기자 목록에 추가
-		list_insert_ordered(&sema->waiters,  &thread_current ()->elem, compare_priority, NULL);
+		waiters_push (&sema->waiters);//대기자 heap에 추가
 		thread_block ();//스레드를 블록(대기)상태로 전환
 	}
 	sema->value--;//세마포어가 사용가능하면(value가 0보다 크면), 세마포어의 값을 하나 감소시켜 자원을 하나 사용한다
@@ -133,11 +275,8 @@ sema_up (struct semaphore *sema) {//V(signal):자원반환시 실행하는 연
 	ASSERT (sema != NULL);
 
 	old_level = intr_disable ();
-	if (!list_empty (&sema->waiters)){ //세마포어의 대기자 목록이 비어있지않다면
-		list_sort (&sema->waiters, compare_priority, NULL);
-		thread_unblock (list_entry (list_pop_front (&sema->waiters),//list_pop_front() 함수는 대기 목록에서 첫 번째 항목을 제거
-					struct thread, elem));//unblcok해서 실행 준비상태로 전환
-	}
+	if (!heap_empty (&sema->waiters)) //세마포어의 대기자 heap이 비어있지않다면
+		thread_unblock (waiters_pop (&sema->waiters));//가장 높은 우선순위 대기자를 unblock해서 실행 준비상태로 전환
 	sema->value++; //세마포어가 관리하는 자원 중 하나가 다시 사용가능해짐
 	thread_preemption();
 	intr_set_level (old_level);
@@ -198,76 +337,139 @@ lock_init (struct lock *lock) {
 	ASSERT (lock != NULL);
 
 	lock->holder = NULL;
-	sema_init (&lock->semaphore, 1);
+	lock->owner = 0;
+	lock->handoff = NULL;
+	heap_init (&lock->waiters, waiter_less, NULL);
+	donation_init (&lock->donation, &lock->waiters, NULL);
+}
+
+/* Low bit of a lock's owner word.  Set while threads may be
+   waiting, so that the holder's release takes the slow path.  On
+   its own, with no holder, it means that the lock was handed to
+   the waiter in LOCK->handoff, which has yet to run. */
+#define LOCK_WAITERS ((uintptr_t) 1)
+
+/* Returns the thread that owner word V names, or NULL. */
+static inline struct thread *
+owner_thread (uintptr_t v) {
+	return (struct thread *) (v & ~LOCK_WAITERS);
+}
+
+/* Atomically replaces LOCK's owner word by NEW if it is OLD.
+   Returns true if it did. */
+static inline bool
+owner_cas (struct lock *lock, uintptr_t old, uintptr_t new) {
+	return __atomic_compare_exchange_n (&lock->owner, &old, new, false,
+			__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
 }
 
+static void lock_acquire_slow (struct lock *);
+static void lock_release_slow (struct lock *);
+
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
 
+   An uncontended acquire is a single compare-and-swap.  Waiting,
+   priority donation and the waiters list are only touched when
+   the lock is held.
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
    we need to sleep. */
 void
 lock_acquire (struct lock *lock) {
+	struct thread *curr = thread_current ();
+
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (!lock_held_by_current_thread (lock));
 
-	if (!thread_mlfqs){
-		struct thread *curr = thread_current();
-		if(lock->holder){
-			curr->wait_on_lock = lock;
-			list_insert_ordered(&lock->holder->donations,&curr->d_elem,compare_donation_priority,NULL);
-			priority_donation();
+	if (!owner_cas (lock, 0, (uintptr_t) curr))
+		lock_acquire_slow (lock);
+	lock->holder = curr;
+}
+
+/* Waits for LOCK, donating priority to its holder, and takes it.
+   A lock handed to a woken waiter counts as held by everyone
+   else, so that the waiter keeps its place in line. */
+static void
+lock_acquire_slow (struct lock *lock) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	for (;;) {
+		uintptr_t v = lock->owner;
+
+		if (owner_thread (v) == NULL
+				&& (lock->handoff == NULL || lock->handoff == curr)) {
+			uintptr_t waiters = heap_empty (&lock->waiters) ? 0 : LOCK_WAITERS;
+			if (owner_cas (lock, v, (uintptr_t) curr | waiters)) {
+				lock->handoff = NULL;
+				break;
+			}
+			continue;
 		}
+		/* Make sure the holder's release will wake us up. */
+		if (!(v & LOCK_WAITERS) && !owner_cas (lock, v, v | LOCK_WAITERS))
+			continue;
 
-		sema_down (&lock->semaphore);
-		curr->wait_on_lock = NULL;
-		lock->holder = curr;
-	}
-	else{
-		sema_down (&lock->semaphore);
-		lock->holder = thread_current ();
+		waiters_push (&lock->waiters);
+		if (!thread_mlfqs) {
+			curr->wait_on_lock = lock;
+			lock_donate (lock);
 		}
+		thread_block ();
 	}
+	curr->wait_on_lock = NULL;
 
-void
-priority_donation(void){
-	struct thread *curr = thread_current();
-	int depth;
-	for (depth=0; depth<8; depth++){
-		if (!curr->wait_on_lock)
-			break;
-		struct thread *holder = curr->wait_on_lock->holder;
-		holder->priority = curr->priority;
-		curr = holder; //holder가 가르키는 thread로 curr 설정
-	}
+	/* Threads still waiting now donate to us. */
+	if (!thread_mlfqs)
+		donate (&lock->donation, curr);
+	intr_set_level (old_level);
+}
+
+/* Updates the donation of LOCK's waiters to its holder, if any,
+   after the best waiter's priority rose or a waiter arrived.  The
+   holder's new priority moves on down the chain of locks through
+   thread_change_priority(). */
+static void
+lock_donate (struct lock *lock) {
+	struct thread *holder = owner_thread (lock->owner);
+
+	if (holder != NULL)
+		donate (&lock->donation, holder);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
    on failure.  The lock must not already be held by the current
-   thread.
+   thread.  Fails while LOCK_WAITERS is set even if the lock is
+   free: the lock belongs to the waiter being woken, and taking it
+   here would skip the donations the waiters owe the holder.
 
    This function will not sleep, so it may be called within an
    interrupt handler. */
 bool
 lock_try_acquire (struct lock *lock) {
-	bool success;
-
 	ASSERT (lock != NULL);
 	ASSERT (!lock_held_by_current_thread (lock));
 
-	success = sema_try_down (&lock->semaphore);
-	if (success)
-		lock->holder = thread_current ();
-	return success;
+	if (lock->owner != 0
+			|| !owner_cas (lock, 0, (uintptr_t) thread_current ()))
+		return false;
+	lock->holder = thread_current ();
+	return true;
 }
 
 /* Releases LOCK, which must be owned by the current thread.
    This is lock_release function.
 
+   If nobody waits, this is a single compare-and-swap; otherwise
+   the donations for LOCK are returned and the highest-priority
+   waiter is woken up.
+
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
    handler. */
@@ -276,41 +478,44 @@ lock_release (struct lock *lock) {
 	ASSERT (lock != NULL);
 	ASSERT (lock_held_by_current_thread (lock));
 
-	if (!thread_mlfqs){
-		remove_lock(lock);
-		update_priority ();
-		lock->holder = NULL;
-		sema_up (&lock->semaphore);
-	}
-	else{
-		lock->holder = NULL;
-		sema_up (&lock->semaphore);
-	}
+	lock->holder = NULL;
+	if (!owner_cas (lock, (uintptr_t) thread_current (), 0))
+		lock_release_slow (lock);
 }
 
-void
-remove_lock (struct lock *lock){
-	struct thread *curr = thread_current ();
-	struct list_elem *e;
-	for (e = list_begin (&curr->donations); e != list_end (&curr->donations); e = list_next (e)){
-		struct thread *t = list_entry (e, struct thread, d_elem);
-		if (t->wait_on_lock == lock)
-			list_remove (&t->d_elem);
-	}
+/* Releases LOCK, whose LOCK_WAITERS bit is set. */
+static void
+lock_release_slow (struct lock *lock) {
+	struct thread *next = NULL;
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	undonate (&lock->donation, thread_current ());
+	if (!thread_mlfqs)
+		update_priority ();
+	if (!heap_empty (&lock->waiters))
+		next = waiters_pop (&lock->waiters);
+	/* Keep LOCK_WAITERS set until NEXT has taken the lock, so that
+	   the fast paths cannot take it first. */
+	lock->handoff = next;
+	__atomic_store_n (&lock->owner,
+			next != NULL ? LOCK_WAITERS : 0, __ATOMIC_RELEASE);
+	if (next != NULL)
+		thread_unblock (next);
+	thread_preemption ();
+	intr_set_level (old_level);
 }
 
+/* Sets the current thread's priority to the higher of its own
+   and the best donation it receives. */
 void
 update_priority (void){
 	struct thread *curr =thread_current ();
-	curr->priority = curr->original_priority;
-	if (!list_empty (&curr->donations)){
-		list_sort (&curr->donations, compare_donation_priority, NULL);
-		struct list_elem *e = list_begin(&curr->donations);
-		struct thread *t = list_entry (e,struct thread, d_elem);
-		/*기부받은 우선순위 중 가장 높은 우선순위로 자신의 우선순위를 업데이트*/
-		if (t->priority > curr->priority)
-			curr->priority = t->priority;
-	}
+	enum intr_level old_level = intr_disable ();
+
+	/*기부받은 우선순위 중 가장 높은 우선순위로 자신의 우선순위를 업데이트*/
+	thread_change_priority (curr, donated_priority (curr));
+	intr_set_level (old_level);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -322,6 +527,177 @@ lock_held_by_current_thread (const struct lock *lock) {
 
 	return lock->holder == thread_current ();
 }
+
+/* Initializes RW as held by nobody.  A reader-writer lock lets
+   any number of readers share the data it guards, or one writer
+   have it alone, so it suits data that is read far more often
+   than it is changed.  Like a lock, it must be released by the
+   thread that acquired it and is not recursive. */
+void
+rwlock_init (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	rw->writer = NULL;
+	rw->reader_cnt = 0;
+	rw->writer_wakeups = 0;
+	list_init (&rw->readers);
+	heap_init (&rw->read_waiters, waiter_less, NULL);
+	heap_init (&rw->write_waiters, waiter_less, NULL);
+	donation_init (&rw->donation, &rw->read_waiters, &rw->write_waiters);
+}
+
+/* Returns the current thread's hold on RW for reading, or NULL. */
+static struct rw_hold *
+rw_hold_find (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	int i;
+
+	for (i = 0; i < RW_HOLD_MAX; i++)
+		if (curr->rw_holds[i].rwlock == rw)
+			return &curr->rw_holds[i];
+	return NULL;
+}
+
+/* Updates the donation of RW's waiters to its writer, or to each
+   of its readers, after a waiter arrived or a waiter's priority
+   changed. */
+static void
+rwlock_donate (struct rwlock *rw) {
+	struct list_elem *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (rw->writer != NULL)
+		donate (&rw->donation, rw->writer);
+	for (e = list_begin (&rw->readers); e != list_end (&rw->readers);
+			e = list_next (e)) {
+		struct rw_hold *hold = list_entry (e, struct rw_hold, elem);
+		donate (&hold->donation, hold->thread);
+	}
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or
+   waits for it.  The current thread must not hold RW already and
+   may hold at most RW_HOLD_MAX rwlocks for reading.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	struct rw_hold *hold;
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (rw->writer != curr);
+	ASSERT (rw_hold_find (rw) == NULL);
+
+	hold = rw_hold_find (NULL);
+	ASSERT (hold != NULL);
+
+	old_level = intr_disable ();
+	while (rw->writer != NULL || rw->writer_wakeups > 0
+			|| !heap_empty (&rw->write_waiters)) {
+		waiters_push (&rw->read_waiters);
+		if (!thread_mlfqs) {
+			curr->wait_on_rwlock = rw;
+			rwlock_donate (rw);
+		}
+		thread_block ();
+	}
+	curr->wait_on_rwlock = NULL;
+
+	hold->rwlock = rw;
+	donation_init (&hold->donation, &rw->read_waiters, &rw->write_waiters);
+	list_push_back (&rw->readers, &hold->elem);
+	rw->reader_cnt++;
+	intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread holds for reading.  The
+   last reader out wakes up the best waiting writer. */
+void
+rwlock_release_read (struct rwlock *rw) {
+	struct rw_hold *hold = rw_hold_find (rw);
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (hold != NULL);
+
+	old_level = intr_disable ();
+	list_remove (&hold->elem);
+	undonate (&hold->donation, thread_current ());
+	hold->rwlock = NULL;
+	if (!thread_mlfqs)
+		update_priority ();
+	if (--rw->reader_cnt == 0 && !heap_empty (&rw->write_waiters)) {
+		rw->writer_wakeups++;
+		thread_unblock (waiters_pop (&rw->write_waiters));
+	}
+	thread_preemption ();
+	intr_set_level (old_level);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.  The current thread must not hold RW already.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (rw->writer != curr);
+	ASSERT (rw_hold_find (rw) == NULL);
+
+	old_level = intr_disable ();
+	while (rw->writer != NULL || rw->reader_cnt > 0) {
+		waiters_push (&rw->write_waiters);
+		if (!thread_mlfqs) {
+			curr->wait_on_rwlock = rw;
+			rwlock_donate (rw);
+		}
+		thread_block ();
+		/* Only a release wakes a writer, and it counted us. */
+		rw->writer_wakeups--;
+	}
+	curr->wait_on_rwlock = NULL;
+
+	rw->writer = curr;
+	/* Threads still waiting now donate to us. */
+	if (!thread_mlfqs)
+		donate (&rw->donation, curr);
+	intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread holds for writing.  Wakes
+   up the best waiting writer if there is one, or else every
+   waiting reader. */
+void
+rwlock_release_write (struct rwlock *rw) {
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (rw->writer == thread_current ());
+
+	old_level = intr_disable ();
+	rw->writer = NULL;
+	undonate (&rw->donation, thread_current ());
+	if (!thread_mlfqs)
+		update_priority ();
+	if (!heap_empty (&rw->write_waiters)) {
+		rw->writer_wakeups++;
+		thread_unblock (waiters_pop (&rw->write_waiters));
+	} else
+		while (!heap_empty (&rw->read_waiters))
+			thread_unblock (waiters_pop (&rw->read_waiters));
+	thread_preemption ();
+	intr_set_level (old_level);
+}
 
 
 
@@ -332,7 +708,7 @@ void
 cond_init (struct condition *cond) {
 	ASSERT (cond != NULL);
 
-	list_init (&cond->waiters);
+	heap_init (&cond->waiters, sema_elem_less, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -358,6 +734,7 @@ cond_init (struct condition *cond) {
 void
 cond_wait (struct condition *cond, struct lock *lock) {
 	struct semaphore_elem waiter;
+	enum intr_level old_level;
 
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
@@ -365,8 +742,17 @@ cond_wait (struct condition *cond, struct lock *lock) {
 	ASSERT (lock_held_by_current_thread (lock));
 
 	sema_init (&waiter.semaphore, 0);
-	//list_push_back (&cond->waiters, &waiter.elem);
-	list_insert_ordered(&cond->waiters, &waiter.elem, compare_sema_priority, NULL);
+	waiter.thread = thread_current ();
+
+	/* The condition's waiters are the heap to fix if our priority
+	   changes; the private semaphore never has another waiter. */
+	old_level = intr_disable ();
+	waiter.seq = next_wait_seq++;
+	heap_push (&cond->waiters, &waiter.elem);
+	waiter.thread->wait_heap = &cond->waiters;
+	waiter.thread->wait_node = &waiter.elem;
+	intr_set_level (old_level);
+
 	lock_release (lock);
 	sema_down (&waiter.semaphore);
 	lock_acquire (lock);
@@ -386,10 +772,14 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED) {
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	if (!list_empty (&cond->waiters)){
-		list_sort(&cond->waiters,compare_sema_priority, NULL);
-		sema_up (&list_entry (list_pop_front (&cond->waiters),
-					struct semaphore_elem, elem)->semaphore);
+	if (!heap_empty (&cond->waiters)){
+		enum intr_level old_level = intr_disable ();
+		struct semaphore_elem *waiter = heap_entry (heap_pop (&cond->waiters),
+				struct semaphore_elem, elem);
+
+		waiter->thread->wait_heap = NULL;
+		intr_set_level (old_level);
+		sema_up (&waiter->semaphore);
 	}
 }
 
@@ -404,6 +794,6 @@ cond_broadcast (struct condition *cond, struct lock *lock) {
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 
-	while (!list_empty (&cond->waiters))
+	while (!heap_empty (&cond->waiters))
 		cond_signal (cond, lock);
 }
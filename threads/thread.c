@@ -26,12 +26,26 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Processes in THREAD_READY state, that is, processes that are
+   ready to run but not actually running.  There is one FIFO queue
+   per priority; bit P of ready_mask is set while ready_queues[P]
+   is non-empty, so the highest ready priority is one bit scan. */
+static struct list ready_queues[PRI_MAX - PRI_MIN + 1];
+static uint64_t ready_mask;
+static size_t ready_cnt;        /* # of threads in ready_queues. */
+
+/* MLFQS decay factor of each of the last DECAY_LOG seconds,
+   indexed by second modulo DECAY_LOG.  A thread's recent_cpu is
+   brought up to date from the log when it is needed instead of
+   every second for every thread. */
+#define DECAY_LOG 64
+static int decay_log[DECAY_LOG];
+static int64_t mlfqs_seconds;   /* # of seconds of decay logged. */
+static int64_t ready_seconds;   /* mlfqs_seconds the ready threads reflect. */
 
 /*Define Sleep Queue*/
-static struct list sleep_list;
+/* Sleeping threads, with the earliest wakeup_ticks on top. */
+static struct heap sleep_heap;
 
 static struct list all_list;
 
@@ -68,6 +82,20 @@ bool compare_priority (const struct list_elem *a,
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* What thread_launch() leaves on the stack of a thread that it
+   switches away from, lowest address first.  The thread's ctx_rsp
+   points to it. */
+struct switch_frame {
+	uint64_t rip;               /* Where to resume. */
+	uint64_t r15;               /* Callee-saved registers. */
+	uint64_t r14;
+	uint64_t r13;
+	uint64_t r12;
+	uint64_t rbx;
+	uint64_t rbp;
+};
+
+void switch_entry (void);
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -76,6 +104,12 @@ static void init_thread (struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule (void);
 static tid_t allocate_tid (void);
+static void ready_push (struct thread *);
+static void ready_remove (struct thread *);
+static int ready_max_priority (void);
+static void ready_refresh (void);
+static bool compare_wakeup_ticks (const struct heap_elem *,
+		const struct heap_elem *, void *aux);
 
 /* Returns true if T appears to point to a valid thread. */
 #define is_thread(t) ((t) != NULL && (t)->magic == THREAD_MAGIC)
@@ -89,9 +123,9 @@ static tid_t allocate_tid (void);
 
 int ready_threads (void){
 	if (thread_current()!=idle_thread)
-		return list_size(&ready_list)+1;
+		return ready_cnt+1;
 	else
-		return list_size(&ready_list);
+		return ready_cnt;
 }
 void increment_recent_cpu(void) {
     struct thread *curr = thread_current();
@@ -107,15 +141,42 @@ void calculate_load_avg(void){
 				mul_fp_int(div_fp(int_to_fp(1), int_to_fp(60)), ready_threads()));
 }
 
+/* Logs this second's decay and applies it to the running thread.
+   Other threads catch up in calculate_recent_cpu() when they are
+   made ready or rescheduled. */
+void decay_recent_cpu(void) {
+    // decay 계산: decay = (2*load_avg) / (2*load_avg + 1)
+    int load_avg_times_2 = mul_fp_int(load_avg, 2);
+    decay_log[mlfqs_seconds % DECAY_LOG] = div_fp(load_avg_times_2, add_fp_int(load_avg_times_2, 1));
+    mlfqs_seconds++;
+
+    calculate_recent_cpu(thread_current());
+}
+
+/* Applies to CURR's recent_cpu every second of decay it has missed. */
 void calculate_recent_cpu(struct thread *curr) {
     if (curr == idle_thread) return; 
 
-    // decay 계산: decay = (2*load_avg) / (2*load_avg + 1)
-    int load_avg_times_2 = mul_fp_int(load_avg, 2);
-    int decay = div_fp(load_avg_times_2, add_fp_int(load_avg_times_2, 1));
+    int64_t s = curr->cpu_seconds;
+    int recent_cpu = curr->recent_cpu;
+
+    // 로그보다 오래된 초는 가장 오래된 decay로 근사, 값이 수렴하면 중단
+    if (mlfqs_seconds - s > DECAY_LOG) {
+        int oldest = decay_log[mlfqs_seconds % DECAY_LOG];
+        for (; s < mlfqs_seconds - DECAY_LOG; s++) {
+            int next = add_fp_int(mul_fp(oldest, recent_cpu), curr->nice);
+            if (next == recent_cpu)
+                break;
+            recent_cpu = next;
+        }
+        s = mlfqs_seconds - DECAY_LOG;
+    }
 
     // recent_cpu 업데이트: recent_cpu = decay * recent_cpu + nice
-    curr->recent_cpu = add_fp_int(mul_fp(decay, curr->recent_cpu), curr->nice);
+    for (; s < mlfqs_seconds; s++)
+        recent_cpu = add_fp_int(mul_fp(decay_log[s % DECAY_LOG], recent_cpu), curr->nice);
+    curr->recent_cpu = recent_cpu;
+    curr->cpu_seconds = mlfqs_seconds;
 }
 
  void calculate_priority(struct thread *curr) {
@@ -123,26 +184,16 @@ void calculate_recent_cpu(struct thread *curr) {
 
     int recent_cpu_div_4 = div_fp_int(curr->recent_cpu, 4); // recent_cpu / 4
     int nice_times_2 = curr->nice * 2; // nice * 2
-    int priority = int_to_fp(PRI_MAX) - recent_cpu_div_4 - int_to_fp(nice_times_2);
-
-    curr->priority = fp_to_int_nearest(priority);
+    int priority = fp_to_int_nearest(int_to_fp(PRI_MAX) - recent_cpu_div_4 - int_to_fp(nice_times_2));
+
+    // run queue 인덱스로 쓰이므로 PRI_MIN..PRI_MAX 범위로 제한
+    if (priority > PRI_MAX)
+        priority = PRI_MAX;
+    else if (priority < PRI_MIN)
+        priority = PRI_MIN;
+    thread_change_priority(curr, priority);
  }
 
- void recalculate_priority(void){
-	struct list_elem *e;
-	for (e=list_begin(&all_list);e != list_end(&all_list);e=list_next(e)){
-		struct thread *t = list_entry(e,struct thread,all_elem);
-		calculate_priority(t);
-	}
-}
-void recalculate_recent_cpu(void){
-	struct list_elem *e;
-	for (e=list_begin(&all_list);e != list_end(&all_list);e=list_next(e)){
-		struct thread *t = list_entry(e,struct thread,all_elem);
-		calculate_recent_cpu(t);
-	}
-}
-
 
 // Global descriptor table for the thread_start.
 // Because the gdt will be setup after the thread_init, we should
@@ -164,6 +215,8 @@ static uint64_t gdt[3] = { 0, 0x00af9a000000ffff, 0x00cf92000000ffff };
    finishes. */
 void
 thread_init (void) {
+	int i;
+
 	ASSERT (intr_get_level () == INTR_OFF);
 
 	/* Reload the temporal gdt for the kernel
@@ -177,11 +230,14 @@ thread_init (void) {
 
 	/* Init the globla thread context */
 	lock_init (&tid_lock);
-	list_init (&ready_list);
+	for (i = 0; i < PRI_MAX - PRI_MIN + 1; i++)
+		list_init (&ready_queues[i]);
+	ready_mask = 0;
+	ready_cnt = 0;
 	list_init (&destruction_req);
 
-	/*Init sleep_list*/
-	list_init (&sleep_list);
+	/*Init sleep_heap*/
+	heap_init (&sleep_heap, compare_wakeup_ticks, NULL);
 
 	list_init (&all_list);
 
@@ -233,6 +289,13 @@ thread_tick (void) {
 		intr_yield_on_return ();
 }
 
+/* Adds N ticks, during which the timer interrupt was held off
+   while the CPU was idle, to the idle statistics. */
+void
+thread_add_idle_ticks (int64_t n) {
+	idle_ticks += n;
+}
+
 /* Prints thread statistics. */
 void
 thread_print_stats (void) {
@@ -258,6 +321,7 @@ thread_print_stats (void) {
 tid_t
 thread_create (const char *name, int priority,
 		thread_func *function, void *aux) {
+	struct switch_frame *frame;
 	struct thread *t;
 	tid_t tid;
 
@@ -272,24 +336,25 @@ thread_create (const char *name, int priority,
 	init_thread (t, name, priority);
 	tid = t->tid = allocate_tid ();
 
-	t->fdt = palloc_get_multiple(PAL_ZERO, FDT_PAGES); 
+	t->fdt = palloc_get_multiple(PAL_ZERO | PAL_ANY, FDT_PAGES); 
 	// printf("[DBG] {%s} palloc result : %p\n", t->name, t->fdt); ////
 
-	/* Call the kernel_thread if it scheduled.
-	 * Note) rdi is 1st argument, and rsi is 2nd argument. */
-	t->tf.rip = (uintptr_t) kernel_thread;
-	t->tf.R.rdi = (uint64_t) function;
-	t->tf.R.rsi = (uint64_t) aux;
-	t->tf.ds = SEL_KDSEG;
-	t->tf.es = SEL_KDSEG;
-	t->tf.ss = SEL_KDSEG;
-	t->tf.cs = SEL_KCSEG;
-	t->tf.eflags = FLAG_IF;
+	/* Call the kernel_thread if it scheduled: the first switch to
+	 * T resumes in switch_entry, which calls kernel_thread (FUNCTION,
+	 * AUX).  The frame ends at the top of the page, which keeps
+	 * that call 16-byte aligned. */
+	frame = (struct switch_frame *) ((uint8_t *) t + PGSIZE) - 1;
+	frame->rip = (uintptr_t) switch_entry;
+	frame->r12 = (uintptr_t) kernel_thread;
+	frame->r13 = (uint64_t) function;
+	frame->r14 = (uint64_t) aux;
+	t->ctx_rsp = (uint64_t) frame;
 
 	/* 새로 생성된 스레드의 recent cpu는
 	 실행중인 스레드의 recent_cpu값을 물려받는다
 	 */
 	t->recent_cpu = thread_current()->recent_cpu;
+	t->cpu_seconds = mlfqs_seconds;
 
 	list_push_back(&thread_current()->child_list,&t->child_elem);
 	
@@ -339,8 +404,12 @@ thread_unblock (struct thread *t) {
 
 	old_level = intr_disable ();
 	ASSERT (t->status == THREAD_BLOCKED);
-	//list_push_back (&ready_list, &t->elem);
-	list_insert_ordered(&ready_list, &t->elem, compare_priority, NULL);
+	if (thread_mlfqs) {
+		/* Blocked threads miss the decay; catch up before queueing. */
+		calculate_recent_cpu (t);
+		calculate_priority (t);
+	}
+	ready_push (t);
 	t->status = THREAD_READY;
 	intr_set_level (old_level);
 }
@@ -404,8 +473,7 @@ thread_yield (void) {
 
 	old_level = intr_disable ();
 	if (curr != idle_thread) //idle thread가 아닐때 현재스레드를 ready list에 추가
-		//list_push_back (&ready_list, &curr->elem);
-		list_insert_ordered(&ready_list, &curr->elem, compare_priority, NULL);
+		ready_push (curr);
 	do_schedule (THREAD_READY);
 	intr_set_level (old_level);
 }
@@ -420,15 +488,41 @@ thread_set_priority (int new_priority) {
 	}
 }
 
-/*ready list 맨 앞에서 기다리고 있는 스레드의 우선순위가
+/* Sets T's priority to PRIORITY.  A ready thread moves to the
+   tail of the run queue for its new priority.  A thread in a wait
+   heap, blocked or still about to block, moves within it, passing
+   any donation on. */
+void
+thread_change_priority (struct thread *t, int priority) {
+	enum intr_level old_level;
+
+	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+	old_level = intr_disable ();
+	if (t->priority != priority) {
+		bool raised = priority > t->priority;
+
+		if (t->status == THREAD_READY) {
+			ready_remove (t);
+			t->priority = priority;
+			ready_push (t);
+		} else
+			t->priority = priority;
+		/* A thread can be in a wait heap without being blocked yet,
+		   as between cond_wait()'s heap_push() and its sema_down(). */
+		if (t->wait_heap != NULL)
+			synch_priority_changed (t, raised);
+	}
+	intr_set_level (old_level);
+}
+
+/*ready queue에서 기다리고 있는 가장 높은 우선순위가
  현재 작업중인 스레드의 우선순위 보다 높다면
  cpu를 기다리고 있던 스레드 한테 양보*/
 void 
 thread_preemption (void)
 {
-	struct list_elem *e = list_begin(&ready_list);
-	struct thread *t = list_entry(e, struct thread, elem);
-	if (!intr_context () && thread_current() != idle_thread && !list_empty (&ready_list) && t->priority > thread_current ()->priority){
+	if (!intr_context () && thread_current() != idle_thread && ready_max_priority () > thread_current ()->priority){
         thread_yield ();
 	}
 }
@@ -493,7 +587,9 @@ idle (void *idle_started_ UNUSED) {
 	for (;;) {
 		/* Let someone else run. */
 		intr_disable ();
+		timer_idle_exit ();
 		thread_block ();
+		timer_idle_enter ();
 
 		/* Re-enable interrupts and wait for the next one.
 
@@ -533,14 +629,16 @@ init_thread (struct thread *t, const char *name, int priority) {
 	memset (t, 0, sizeof *t);
 	t->status = THREAD_BLOCKED;
 	strlcpy (t->name, name, sizeof t->name);
-	t->tf.rsp = (uint64_t) t + PGSIZE - sizeof (void *);
 	t->priority = priority;
 	t->magic = THREAD_MAGIC;
 
-	/*Init donations list*/
-	list_init (&t->donations);
+	/*Init donations heap*/
+	heap_init (&t->donations, donation_less, NULL);
 
 	t->wait_on_lock = NULL;
+	t->wait_on_rwlock = NULL;
+	for (int i = 0; i < RW_HOLD_MAX; i++)
+		t->rw_holds[i].thread = t;
 
 	t->original_priority = priority;
 
@@ -558,6 +656,9 @@ init_thread (struct thread *t, const char *name, int priority) {
 	sema_init(&t->child_load_sema,0);
 
 	t->fd_idx = 2;
+#ifdef VM
+	t->stack_floor = (void *) (USER_STACK - STACK_LIMIT_DEFAULT);
+#endif
 	// t->fdt[0] = 0;
 	// t->fdt[1] = 0;
 	// t->fdt[2] = 0;
@@ -571,10 +672,73 @@ init_thread (struct thread *t, const char *name, int priority) {
    idle_thread. */
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
+	struct thread *t;
+
+	if (ready_mask == 0)
 		return idle_thread;
-	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
+	if (thread_mlfqs && ready_seconds != mlfqs_seconds)
+		ready_refresh ();
+	t = list_entry (list_front (&ready_queues[ready_max_priority () - PRI_MIN]),
+			struct thread, elem);
+	ready_remove (t);
+	return t;
+}
+
+/* Appends T to the run queue for its priority. */
+static void
+ready_push (struct thread *t) {
+	int idx = t->priority - PRI_MIN;
+
+	list_push_back (&ready_queues[idx], &t->elem);
+	ready_mask |= 1ULL << idx;
+	ready_cnt++;
+}
+
+/* Takes T off its run queue.  T's priority must not have changed
+   since ready_push(). */
+static void
+ready_remove (struct thread *t) {
+	int idx = t->priority - PRI_MIN;
+
+	list_remove (&t->elem);
+	if (list_empty (&ready_queues[idx]))
+		ready_mask &= ~(1ULL << idx);
+	ready_cnt--;
+}
+
+/* Brings the recent_cpu and priority of every ready thread up to
+   date with the decay logged since the last call.  Runs at most
+   once a second, at a reschedule rather than in the timer
+   interrupt. */
+static void
+ready_refresh (void) {
+	int pri;
+
+	for (pri = PRI_MAX; pri >= PRI_MIN; pri--) {
+		struct list *q = &ready_queues[pri - PRI_MIN];
+		struct list_elem *e = list_begin (q);
+
+		while (e != list_end (q)) {
+			struct thread *t = list_entry (e, struct thread, elem);
+
+			/* T may move to another queue. */
+			e = list_next (e);
+			if (t->cpu_seconds != mlfqs_seconds) {
+				calculate_recent_cpu (t);
+				calculate_priority (t);
+			}
+		}
+	}
+	ready_seconds = mlfqs_seconds;
+}
+
+/* Returns the highest priority of any ready thread, or PRI_MIN - 1
+   if no thread is ready. */
+static int
+ready_max_priority (void) {
+	if (ready_mask == 0)
+		return PRI_MIN - 1;
+	return PRI_MIN + 63 - __builtin_clzll (ready_mask);
 }
 
 /* Use iretq to launch the thread */
@@ -617,62 +781,61 @@ do_iret (struct intr_frame *tf) {
    added at the end of the function. */
 static void
 thread_launch (struct thread *th) { //새로운 스레드로의 컨텍스트 전환
-	uint64_t tf_cur = (uint64_t) &running_thread ()->tf; //현재 실행중인 스레드의 프레임
-	uint64_t tf = (uint64_t) &th->tf; // 새로전환할 스레드의 프레임(스레드 상태저장) 주소
+	struct thread *curr = running_thread ();
+
 	ASSERT (intr_get_level () == INTR_OFF);
 
 	/* The main switching logic.
-	 * We first restore the whole execution context into the intr_frame
-	 * and then switching to the next thread by calling do_iret.
-	 * Note that, we SHOULD NOT use any stack from here
-	 * until switching is done. */
+	 * Every thread switches out from here, in the kernel, so the
+	 * switch only has to keep what a function call keeps: the
+	 * callee-saved registers and the stack pointer.  A process's
+	 * user context stays in the intr_frame that its syscall or
+	 * interrupt pushed on its kernel stack, and goes back through
+	 * that path.  Interrupts are off on both sides, so RFLAGS
+	 * needs no saving either.
+	 *
+	 * We push a struct switch_frame, save the stack pointer in the
+	 * current thread, load the next thread's and return into its
+	 * resume address. */
 	__asm __volatile (
-			/* Store registers that will be used. */
-			"push %%rax\n"
+			"push %%rbp\n"
 			"push %%rbx\n"
-			"push %%rcx\n"
-			/* Fetch input once */
-			"movq %0, %%rax\n"
-			"movq %1, %%rcx\n"
-			"movq %%r15, 0(%%rax)\n"
-			"movq %%r14, 8(%%rax)\n"
-			"movq %%r13, 16(%%rax)\n"
-			"movq %%r12, 24(%%rax)\n"
-			"movq %%r11, 32(%%rax)\n"
-			"movq %%r10, 40(%%rax)\n"
-			"movq %%r9, 48(%%rax)\n"
-			"movq %%r8, 56(%%rax)\n"
-			"movq %%rsi, 64(%%rax)\n"
-			"movq %%rdi, 72(%%rax)\n"
-			"movq %%rbp, 80(%%rax)\n"
-			"movq %%rdx, 88(%%rax)\n"
-			"pop %%rbx\n"              // Saved rcx
-			"movq %%rbx, 96(%%rax)\n"
-			"pop %%rbx\n"              // Saved rbx
-			"movq %%rbx, 104(%%rax)\n"
-			"pop %%rbx\n"              // Saved rax
-			"movq %%rbx, 112(%%rax)\n"
-			"addq $120, %%rax\n"
-			"movw %%es, (%%rax)\n"
-			"movw %%ds, 8(%%rax)\n"
-			"addq $32, %%rax\n"
-			"call __next\n"         // read the current rip.
-			"__next:\n"
+			"push %%r12\n"
+			"push %%r13\n"
+			"push %%r14\n"
+			"push %%r15\n"
+			"leaq 1f(%%rip), %%rax\n"
+			"push %%rax\n"            // resume address
+			"movq %%rsp, (%0)\n"      // curr->ctx_rsp
+			"movq %1, %%rsp\n"        // th->ctx_rsp
+			"ret\n"
+			"1:\n"
+			"pop %%r15\n"
+			"pop %%r14\n"
+			"pop %%r13\n"
+			"pop %%r12\n"
 			"pop %%rbx\n"
-			"addq $(out_iret -  __next), %%rbx\n"
-			"movq %%rbx, 0(%%rax)\n" // rip
-			"movw %%cs, 8(%%rax)\n"  // cs
-			"pushfq\n"
-			"popq %%rbx\n"
-			"mov %%rbx, 16(%%rax)\n" // eflags
-			"mov %%rsp, 24(%%rax)\n" // rsp
-			"movw %%ss, 32(%%rax)\n"
-			"mov %%rcx, %%rdi\n"
-			"call do_iret\n"
-			"out_iret:\n"
-			: : "g"(tf_cur), "g" (tf) : "memory"
-			);
-}
+			"pop %%rbp\n"
+			: : "r" (&curr->ctx_rsp), "r" (th->ctx_rsp)
+			: "rax", "rcx", "rdx", "rsi", "rdi", "r8", "r9", "r10", "r11",
+			  "cc", "memory");
+}
+
+/* Where a new thread first resumes.  Pops the switch_frame that
+   thread_create() built, as thread_launch() would, and calls the
+   function in R12 with R13 and R14 as its arguments. */
+__asm (
+		".text\n"
+		"switch_entry:\n"
+		"pop %r15\n"
+		"pop %r14\n"
+		"pop %r13\n"
+		"pop %r12\n"
+		"pop %rbx\n"
+		"pop %rbp\n"
+		"movq %r13, %rdi\n"
+		"movq %r14, %rsi\n"
+		"call *%r12\n");
 
 /* Schedules a new process. At entry, interrupts must be off.
  * This function modify current thread's status to status and then
@@ -760,25 +923,36 @@ thread_sleep(int64_t ticks) {
 
 	old_level = intr_disable ();
 	if (curr != idle_thread)
-		list_push_back (&sleep_list, &curr->elem);
-		//list_insert_ordered(&sleep_list, &curr->elem, compare_priority, NULL);
+		heap_push (&sleep_heap, &curr->sleep_elem);
 	do_schedule (THREAD_BLOCKED);
 	intr_set_level (old_level);
 }
 
+/* Wakes up every sleeping thread whose wakeup_ticks is at or
+   before TICKS.  Touches only those threads. */
 void
 thread_wakeup(int64_t ticks) {
-    struct list_elem *e = list_begin(&sleep_list);
+    while (thread_next_wakeup () <= ticks) {
+        struct thread *t = heap_entry (heap_pop (&sleep_heap),
+                struct thread, sleep_elem);
+        thread_unblock(t);
+    }
+}
 
-    while (e != list_end(&sleep_list)) {
-        struct thread *t = list_entry(e, struct thread, elem);
-        struct list_elem *next = list_next(e); 
+/* Returns the earliest wakeup_ticks of any sleeping thread, or
+   INT64_MAX if no thread sleeps. */
+int64_t
+thread_next_wakeup (void) {
+	struct heap_elem *e = heap_top (&sleep_heap);
 
-        if (ticks >= t->wakeup_ticks) {
-            e = list_remove(e);
-            thread_unblock(t);
-        } else {
-            e = next; 
-        }
-    }
+	if (e == NULL)
+		return INT64_MAX;
+	return heap_entry (e, struct thread, sleep_elem)->wakeup_ticks;
+}
+
+static bool
+compare_wakeup_ticks (const struct heap_elem *a,
+		const struct heap_elem *b, void *aux UNUSED) {
+	return heap_entry (a, struct thread, sleep_elem)->wakeup_ticks
+		< heap_entry (b, struct thread, sleep_elem)->wakeup_ticks;
 }
@@ -0,0 +1,375 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* A workqueue. */
+struct workqueue {
+	struct list_elem elem;      /* In wq_list. */
+	char name[16];              /* Name (for debugging). */
+	int priority;               /* Priority its work runs at. */
+	int max_active;             /* Most items running at once. */
+	int active;                 /* Items running now. */
+	struct list pending;        /* Queued items, oldest first. */
+};
+
+/* All workqueues.  A queue moves to the back each time one of
+   its items starts, so that queues of equal priority take
+   turns. */
+static struct list wq_list;
+
+/* Delayed work whose timer is running, soonest first. */
+static struct heap timer_heap;
+
+/* Expiry of the top of timer_heap, or INT64_MAX if it is empty,
+   so that the timer interrupt costs one comparison on ticks when
+   nothing is due. */
+static int64_t next_expiry;
+
+/* Upped once for each item queued.  Idle workers wait on it. */
+static struct semaphore work_sema;
+
+/* The pool starts with one worker.  A worker that takes an item
+   while more are pending and no other worker is idle starts
+   another, up to WQ_WORKERS. */
+static int worker_cnt;          /* Workers started. */
+static int idle_cnt;            /* Workers waiting on work_sema. */
+static int pending_cnt;         /* Items queued and not yet taken. */
+
+/* wq_list, timer_heap, the counts above and every queue and work
+   item are only touched with interrupts off, since work may be
+   queued from an interrupt handler. */
+
+struct workqueue *system_wq;
+
+static void worker (void *aux);
+static void worker_start (void);
+static struct workqueue *work_next (work_func **, void **aux);
+static void timer_update (void);
+static bool expires_less (const struct heap_elem *,
+		const struct heap_elem *, void *aux);
+
+/* Initializes the workqueues, creates system_wq and starts the
+   first worker thread.  Must be called after thread_start(). */
+void
+workqueue_init (void) {
+	list_init (&wq_list);
+	heap_init (&timer_heap, expires_less, NULL);
+	next_expiry = INT64_MAX;
+	sema_init (&work_sema, 0);
+
+	system_wq = workqueue_create ("system", PRI_DEFAULT, WQ_WORKERS);
+	if (system_wq == NULL)
+		PANIC ("workqueue_init: out of memory");
+	worker_cnt = 1;
+	if (thread_create ("kworker/0", PRI_DEFAULT, worker, NULL) == TID_ERROR)
+		PANIC ("workqueue_init: cannot start kworker/0");
+}
+
+/* Creates and returns a workqueue called NAME whose work runs at
+   PRIORITY, with at most MAX_ACTIVE items running at once.
+   Returns a null pointer if memory is short.  Workqueues are
+   never destroyed.
+
+   Under the MLFQS, workers keep the priority the scheduler gives
+   them and PRIORITY only orders the queues. */
+struct workqueue *
+workqueue_create (const char *name, int priority, int max_active) {
+	struct workqueue *wq;
+	enum intr_level old_level;
+
+	ASSERT (name != NULL);
+	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+	ASSERT (max_active > 0);
+
+	wq = malloc (sizeof *wq);
+	if (wq == NULL)
+		return NULL;
+	strlcpy (wq->name, name, sizeof wq->name);
+	wq->priority = priority;
+	wq->max_active = max_active;
+	wq->active = 0;
+	list_init (&wq->pending);
+
+	old_level = intr_disable ();
+	list_push_back (&wq_list, &wq->elem);
+	intr_set_level (old_level);
+	return wq;
+}
+
+/* Initializes WORK to call FUNC, passing AUX, when it runs. */
+void
+work_init (struct work *work, work_func *func, void *aux) {
+	ASSERT (work != NULL);
+	ASSERT (func != NULL);
+
+	work->func = func;
+	work->aux = aux;
+	work->wq = NULL;
+}
+
+/* Queues WORK on WQ.  Returns false, doing nothing, if WORK is
+   already pending.  WORK may be queued again as soon as it
+   starts to run.
+
+   This function may be called from an interrupt handler. */
+bool
+queue_work (struct workqueue *wq, struct work *work) {
+	enum intr_level old_level;
+	bool queued;
+
+	ASSERT (wq != NULL);
+	ASSERT (work != NULL);
+
+	old_level = intr_disable ();
+	queued = work->wq == NULL;
+	if (queued) {
+		work->wq = wq;
+		list_push_back (&wq->pending, &work->elem);
+		pending_cnt++;
+	}
+	intr_set_level (old_level);
+
+	if (queued)
+		sema_up (&work_sema);
+	return queued;
+}
+
+/* Takes WORK off its queue if it has not started to run yet.
+   Returns true if it did.  Does not wait for WORK if it is
+   running.
+
+   This function may be called from an interrupt handler. */
+bool
+cancel_work (struct work *work) {
+	enum intr_level old_level;
+	bool cancelled;
+
+	ASSERT (work != NULL);
+
+	old_level = intr_disable ();
+	cancelled = work->wq != NULL;
+	if (cancelled) {
+		list_remove (&work->elem);
+		work->wq = NULL;
+		pending_cnt--;
+	}
+	intr_set_level (old_level);
+	return cancelled;
+}
+
+/* Returns true if WORK is queued and has not started to run. */
+bool
+work_pending (const struct work *work) {
+	return work->wq != NULL;
+}
+
+/* Initializes DW to call FUNC, passing AUX, when it runs. */
+void
+delayed_work_init (struct delayed_work *dw, work_func *func, void *aux) {
+	ASSERT (dw != NULL);
+
+	work_init (&dw->work, func, aux);
+	dw->wq = NULL;
+}
+
+/* Queues DW on WQ once TICKS timer ticks have passed, or right
+   away if TICKS is not positive.  Returns false, doing nothing,
+   if DW's timer is already running or DW is pending.
+
+   This function may be called from an interrupt handler. */
+bool
+queue_delayed_work (struct workqueue *wq, struct delayed_work *dw,
+		int64_t ticks) {
+	int64_t expires = timer_ticks () + ticks;
+	enum intr_level old_level;
+	bool queued;
+
+	ASSERT (wq != NULL);
+	ASSERT (dw != NULL);
+
+	if (ticks <= 0)
+		return queue_work (wq, &dw->work);
+
+	old_level = intr_disable ();
+	queued = dw->wq == NULL && dw->work.wq == NULL;
+	if (queued) {
+		dw->wq = wq;
+		dw->expires = expires;
+		heap_push (&timer_heap, &dw->timer_elem);
+		timer_update ();
+	}
+	intr_set_level (old_level);
+	return queued;
+}
+
+/* Stops DW's timer, or takes DW off its queue if the timer has
+   run out but DW has not started to run.  Returns true if it
+   did either. */
+bool
+cancel_delayed_work (struct delayed_work *dw) {
+	enum intr_level old_level;
+	bool cancelled;
+
+	ASSERT (dw != NULL);
+
+	old_level = intr_disable ();
+	cancelled = dw->wq != NULL;
+	if (cancelled) {
+		heap_remove (&timer_heap, &dw->timer_elem);
+		dw->wq = NULL;
+		timer_update ();
+	}
+	intr_set_level (old_level);
+	return cancelled || cancel_work (&dw->work);
+}
+
+/* Called by the timer interrupt handler.  Queues each delayed
+   item whose timer runs out at or before TICKS. */
+void
+workqueue_timer (int64_t ticks) {
+	enum intr_level old_level;
+	int queued = 0;
+
+	if (ticks < next_expiry)
+		return;
+
+	old_level = intr_disable ();
+	while (!heap_empty (&timer_heap)) {
+		struct delayed_work *dw = heap_entry (heap_top (&timer_heap),
+				struct delayed_work, timer_elem);
+
+		if (dw->expires > ticks)
+			break;
+		heap_pop (&timer_heap);
+		if (dw->work.wq == NULL) {
+			dw->work.wq = dw->wq;
+			list_push_back (&dw->wq->pending, &dw->work.elem);
+			pending_cnt++;
+			queued++;
+		}
+		dw->wq = NULL;
+	}
+	timer_update ();
+	intr_set_level (old_level);
+
+	while (queued-- > 0)
+		sema_up (&work_sema);
+}
+
+/* Returns the tick at which the next delayed item is due, or
+   INT64_MAX if no timer is running. */
+int64_t
+workqueue_next_timer (void) {
+	return next_expiry;
+}
+
+/* Worker thread.  Runs work, best queue first, for as long as
+   there is work it may start, then waits for more. */
+static void
+worker (void *aux UNUSED) {
+	for (;;) {
+		struct workqueue *wq;
+		enum intr_level old_level;
+		work_func *func;
+		void *arg;
+
+		old_level = intr_disable ();
+		idle_cnt++;
+		sema_down (&work_sema);
+		idle_cnt--;
+		intr_set_level (old_level);
+
+		while ((wq = work_next (&func, &arg)) != NULL) {
+			worker_start ();
+			thread_set_priority (wq->priority);
+			func (arg);
+
+			old_level = intr_disable ();
+			wq->active--;
+			intr_set_level (old_level);
+		}
+	}
+}
+
+/* Starts another worker if work is left that no idle worker will
+   take and the pool is not full. */
+static void
+worker_start (void) {
+	enum intr_level old_level;
+	char name[sizeof "kworker/" + 10];
+	int id = -1;
+
+	old_level = intr_disable ();
+	if (pending_cnt > idle_cnt && worker_cnt < WQ_WORKERS)
+		id = worker_cnt++;
+	intr_set_level (old_level);
+	if (id < 0)
+		return;
+
+	snprintf (name, sizeof name, "kworker/%d", id);
+	if (thread_create (name, PRI_DEFAULT, worker, NULL) == TID_ERROR) {
+		old_level = intr_disable ();
+		worker_cnt--;
+		intr_set_level (old_level);
+	}
+}
+
+/* Takes the oldest item off the highest-priority queue that has
+   work and is below its max_active, and returns that queue, with
+   the item's function and argument in *FUNC and *AUX.  Returns a
+   null pointer if no item may start. */
+static struct workqueue *
+work_next (work_func **func, void **aux) {
+	struct workqueue *best = NULL;
+	struct list_elem *e;
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	for (e = list_begin (&wq_list); e != list_end (&wq_list);
+			e = list_next (e)) {
+		struct workqueue *wq = list_entry (e, struct workqueue, elem);
+
+		if (!list_empty (&wq->pending) && wq->active < wq->max_active
+				&& (best == NULL || wq->priority > best->priority))
+			best = wq;
+	}
+	if (best != NULL) {
+		struct work *work = list_entry (list_pop_front (&best->pending),
+				struct work, elem);
+
+		work->wq = NULL;
+		pending_cnt--;
+		*func = work->func;
+		*aux = work->aux;
+		best->active++;
+		list_remove (&best->elem);
+		list_push_back (&wq_list, &best->elem);
+	}
+	intr_set_level (old_level);
+	return best;
+}
+
+/* Sets next_expiry from the top of timer_heap.  Interrupts must
+   be off. */
+static void
+timer_update (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	next_expiry = heap_empty (&timer_heap) ? INT64_MAX
+		: heap_entry (heap_top (&timer_heap), struct delayed_work,
+				timer_elem)->expires;
+}
+
+/* Timer heap: earliest expiry first. */
+static bool
+expires_less (const struct heap_elem *a, const struct heap_elem *b,
+		void *aux UNUSED) {
+	return heap_entry (a, struct delayed_work, timer_elem)->expires
+		< heap_entry (b, struct delayed_work, timer_elem)->expires;
+}
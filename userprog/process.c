@@ -8,25 +8,31 @@
 #include <string.h>
 #include "userprog/gdt.h"
 #include "userprog/tss.h"
+#include "devices/timer.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 #include "intrinsic.h"
 #include "threads/synch.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/checkpoint.h"
 #include "userprog/syscall.h"
 #endif
 
 static void process_cleanup (void);
-static bool load (const char *file_name, struct intr_frame *if_);
+static bool load (const char *file_name, struct intr_frame *if_,
+		bool *restored);
 static void initd (void *f_name);
 static void __do_fork (void *);
 struct thread *find_child(tid_t child_tid);
@@ -97,9 +103,9 @@ process_fork (const char *name, struct intr_frame *if_ UNUSED) {
 
 	struct thread *t = find_child(tid);
 
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_write(&filesys_lock);
 	sema_down(&t->child_load_sema);
-	lock_release(&filesys_lock);
+	rwlock_release_write(&filesys_lock);
 
 	if (t->exit_status == -1){
 		// sema_up(&t->exit_sema);
@@ -177,8 +183,19 @@ __do_fork (void *aux) {
 	process_activate (current);
 #ifdef VM
 	supplemental_page_table_init (&current->spt);
+	current->fault_hist = calloc (1, sizeof *current->fault_hist);
+	if (current->fault_hist == NULL)
+		goto error;
 	if (!supplemental_page_table_copy (&current->spt, &parent->spt))
 		goto error;
+	/* The copy only shared the frames; hand the child the parent's
+	 * page tables themselves, copied lazily on the first write. */
+	if (!pml4_share_user (current->pml4, parent->pml4))
+		goto error;
+	current->stack_bottom = parent->stack_bottom;
+	current->stack_floor = parent->stack_floor;
+	current->stack_prefault = parent->stack_prefault;
+	current->rss_limit = parent->rss_limit;
 #else
 	if (!pml4_for_each (parent->pml4, duplicate_pte, parent))
 		goto error;
@@ -235,19 +252,30 @@ process_exec (void *f_name) {
 	process_cleanup ();
 	supplemental_page_table_init(&thread_current()->spt); //초기화해주지 않으면 exec 실패함
 
-	char *fn_copy;
-	fn_copy = palloc_get_page (0);
-	if (fn_copy == NULL)
-		return TID_ERROR;
-	strlcpy (fn_copy, file_name, PGSIZE);
-	char *token, *save_ptrr;
-	token = strtok_r(fn_copy," ",&save_ptrr);
+	/* 메모리가 부족하면 load 실패와 같은 경로로 빠져나간다 */
+	bool restored = false;
+	char *fn_copy = palloc_get_page (0);
+	success = fn_copy != NULL;
+#ifdef VM
+	/* 폴트 핸들러에서 할당하지 않도록 폴트 지연 히스토그램은 여기서 만든다 */
+	struct thread *curr = thread_current ();
+	if (curr->fault_hist == NULL)
+		curr->fault_hist = calloc (1, sizeof *curr->fault_hist);
+	success = success && curr->fault_hist != NULL;
+#endif
 
-	/* And then load the binary */
-	lock_acquire(&filesys_lock);
-	success = load (token, &_if);
+	if (success)
+	{
+		strlcpy (fn_copy, file_name, PGSIZE);
+		char *token, *save_ptrr;
+		token = strtok_r(fn_copy," ",&save_ptrr);
+
+		/* And then load the binary */
+		rwlock_acquire_write(&filesys_lock);
+		success = load (token, &_if, &restored);
+		rwlock_release_write(&filesys_lock);
+	}
 	palloc_free_page(fn_copy);
-	lock_release(&filesys_lock);
 
 	/* If load failed, quit. */
 	if (!success)
@@ -256,6 +284,14 @@ process_exec (void *f_name) {
 		return -1;
 	}
 
+	/* 체크포인트에서 복원한 프로세스는 저장된 레지스터로 바로 재개한다 */
+	if (restored)
+	{
+		palloc_free_page(file_name);
+		do_iret(&_if);
+		NOT_REACHED();
+	}
+
 	/* argument_passing(f_name); */
 	int arg_cnt=1;
 	char *save_ptr;
@@ -393,6 +429,10 @@ process_exit (void) {
 	file_close(curr->exec_file);
 	// printf("PEXIT(): 4\n"); ///
 	process_cleanup ();
+#ifdef VM
+	free(curr->fault_hist);
+	curr->fault_hist = NULL;
+#endif
 	// printf("PEXIT(): 5\n"); ///
 	sema_up(&curr->wait_sema); //자식이 종료 될때까지 대기하고 있는 부모에게 signal을 보낸다.
 	// printf("PEXIT(): 6\n"); ///
@@ -497,50 +537,162 @@ static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		uint32_t read_bytes, uint32_t zero_bytes,
 		bool writable);
 
-/* Loads an ELF executable from FILE_NAME into the current thread.
- * Stores the executable's entry point into *RIP
- * and its initial stack pointer into *RSP.
- * Returns true if successful, false otherwise. */
-static bool
-load (const char *file_name, struct intr_frame *if_) {
-	struct thread *t = thread_current ();
-	struct ELF ehdr;
-	struct file *file = NULL;
-	off_t file_ofs;
-	bool success = false;
-	int i;
+/* One PT_LOAD segment of an executable, already validated and
+ * rounded to the page boundaries that load_segment() expects. */
+struct exec_segment {
+	off_t file_page;            /* Page-aligned offset in the file. */
+	uint64_t mem_page;          /* Page-aligned user virtual address. */
+	uint32_t read_bytes;        /* Bytes to read from FILE_PAGE on. */
+	uint32_t zero_bytes;        /* Bytes to zero after READ_BYTES. */
+	bool writable;
+};
 
+/* Parsed program headers of an executable.
+ * Entries of the exec cache keep INODE open, so its write
+ * generation stays meaningful for as long as the entry lives.
+ * remove() drops the entry first, so that a removed executable's
+ * blocks are freed once its last real opener closes it. */
+struct exec_image {
+	struct list_elem elem;      /* Element in exec_cache. */
+	struct inode *inode;        /* Executable's inode. */
+	unsigned write_gen;         /* INODE's generation when parsed. */
+	off_t length;               /* INODE's length when parsed. */
+	int64_t last_used;          /* Timer tick of the last exec. */
+	uint64_t entry;             /* Entry point. */
+	int seg_cnt;                /* Number of entries in SEGS. */
+	struct exec_segment segs[]; /* Loadable segments. */
+};
 
-	/* Allocate and activate page directory. */
-	t->pml4 = pml4_create ();
-	if (t->pml4 == NULL)
-		goto done;
-	process_activate (thread_current ());
+/* Number of executables kept in the exec cache. */
+#define EXEC_CACHE_SIZE 16
 
-	// printf("1.%s\n",file_name);
-	// char *fn_copy;
-	// fn_copy = palloc_get_page (0);
-	// if (fn_copy == NULL)
-	// 	return TID_ERROR;
-	// strlcpy (fn_copy, file_name, PGSIZE);
-	// char *token, *save_ptr;
-	// token = strtok_r(fn_copy," ",&save_ptr);
-	// printf("2.%s\n",token);
+/* Timer ticks an entry may go unused before it is dropped, so that
+ * an idle system does not keep old binaries' inodes open. */
+#define EXEC_CACHE_IDLE (30 * TIMER_FREQ)
 
-	/* Open executable file. */
-	
-	file = filesys_open (file_name);
-	
-	// printf("###########%p\n",file);
-	if (file == NULL) {
-		printf ("load: %s: open failed\n", file_name);
-		goto done;
+/* Recently executed images, most recently used first.
+ * Only touched under filesys_lock. */
+static struct list exec_cache;
+static size_t exec_cache_cnt;
+
+/* Drops idle entries.  Armed while the cache is not empty. */
+static struct delayed_work exec_cache_trim_work;
+
+static void exec_cache_trim (void *aux);
+
+/* Initializes the exec cache. */
+void
+exec_cache_init (void) {
+	list_init (&exec_cache);
+	exec_cache_cnt = 0;
+	delayed_work_init (&exec_cache_trim_work, exec_cache_trim, NULL);
+}
+
+static void
+exec_image_free (struct exec_image *image) {
+	inode_close (image->inode);
+	free (image);
+}
+
+/* Returns the cached image for FILE and moves it to the front of
+ * the cache, or a null pointer if FILE has not been parsed since
+ * it was last modified. */
+static struct exec_image *
+exec_cache_lookup (struct file *file) {
+	struct inode *inode = file_get_inode (file);
+	struct list_elem *e;
+
+	for (e = list_begin (&exec_cache); e != list_end (&exec_cache);
+			e = list_next (e)) {
+		struct exec_image *image = list_entry (e, struct exec_image, elem);
+		if (image->inode != inode)
+			continue;
+		if (image->write_gen != inode_get_generation (inode)
+				|| image->length != inode_length (inode)) {
+			/* Stale: the binary was rewritten since we parsed it. */
+			list_remove (e);
+			exec_cache_cnt--;
+			exec_image_free (image);
+			return NULL;
+		}
+		list_remove (e);
+		list_push_front (&exec_cache, e);
+		image->last_used = timer_ticks ();
+		return image;
 	}
-	// palloc_free_page(fn_copy);
-	
+	return NULL;
+}
+
+/* Drops the cached image of INODE, if any.  Caller must hold
+ * filesys_lock. */
+void
+exec_cache_forget (struct inode *inode) {
+	struct list_elem *e;
+
+	for (e = list_begin (&exec_cache); e != list_end (&exec_cache);
+			e = list_next (e)) {
+		struct exec_image *image = list_entry (e, struct exec_image, elem);
+		if (image->inode == inode) {
+			list_remove (e);
+			exec_cache_cnt--;
+			exec_image_free (image);
+			return;
+		}
+	}
+}
+
+/* Adds IMAGE to the front of the cache, evicting the least
+ * recently used entry if the cache is full. */
+static void
+exec_cache_insert (struct exec_image *image) {
+	if (exec_cache_cnt == EXEC_CACHE_SIZE) {
+		struct exec_image *victim = list_entry (list_pop_back (&exec_cache),
+				struct exec_image, elem);
+		exec_image_free (victim);
+		exec_cache_cnt--;
+	}
+	list_push_front (&exec_cache, &image->elem);
+	exec_cache_cnt++;
+	image->last_used = timer_ticks ();
+	queue_delayed_work (system_wq, &exec_cache_trim_work, EXEC_CACHE_IDLE);
+}
+
+/* Runs on system_wq.  Drops the entries that have gone unused for
+ * EXEC_CACHE_IDLE ticks, and comes back when the oldest of the
+ * rest will have. */
+static void
+exec_cache_trim (void *aux UNUSED) {
+	int64_t now = timer_ticks ();
+
+	rwlock_acquire_write (&filesys_lock);
+	while (!list_empty (&exec_cache)) {
+		struct exec_image *image = list_entry (list_back (&exec_cache),
+				struct exec_image, elem);
+
+		if (now - image->last_used < EXEC_CACHE_IDLE) {
+			queue_delayed_work (system_wq, &exec_cache_trim_work,
+					image->last_used + EXEC_CACHE_IDLE - now);
+			break;
+		}
+		list_pop_back (&exec_cache);
+		exec_cache_cnt--;
+		exec_image_free (image);
+	}
+	rwlock_release_write (&filesys_lock);
+}
+
+/* Reads and validates the ELF header and program headers of FILE
+ * and returns the resulting segment plan, or a null pointer if
+ * FILE is not a loadable executable or memory is short. */
+static struct exec_image *
+exec_image_parse (struct file *file, const char *file_name) {
+	struct exec_image *image;
+	struct ELF ehdr;
+	off_t file_ofs;
+	int i;
 
 	/* Read and verify executable header. */
-	if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
+	if (file_read_at (file, &ehdr, sizeof ehdr, 0) != sizeof ehdr
 			|| memcmp (ehdr.e_ident, "\177ELF\2\1\1", 7)
 			|| ehdr.e_type != 2
 			|| ehdr.e_machine != 0x3E // amd64
@@ -548,20 +700,27 @@ load (const char *file_name, struct intr_frame *if_) {
 			|| ehdr.e_phentsize != sizeof (struct Phdr)
 			|| ehdr.e_phnum > 1024) {
 		printf ("load: %s: error loading executable\n", file_name);
-		goto done;
+		return NULL;
 	}
 
+	image = malloc (sizeof *image + ehdr.e_phnum * sizeof image->segs[0]);
+	if (image == NULL)
+		return NULL;
+	image->inode = file_get_inode (file);
+	image->write_gen = inode_get_generation (image->inode);
+	image->length = file_length (file);
+	image->entry = ehdr.e_entry;
+	image->seg_cnt = 0;
+
 	/* Read program headers. */
 	file_ofs = ehdr.e_phoff;
 	for (i = 0; i < ehdr.e_phnum; i++) {
 		struct Phdr phdr;
 
 		if (file_ofs < 0 || file_ofs > file_length (file))
-			goto done;
-		file_seek (file, file_ofs);
-
-		if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
-			goto done;
+			goto error;
+		if (file_read_at (file, &phdr, sizeof phdr, file_ofs) != sizeof phdr)
+			goto error;
 		file_ofs += sizeof phdr;
 		switch (phdr.p_type) {
 			case PT_NULL:
@@ -574,35 +733,97 @@ load (const char *file_name, struct intr_frame *if_) {
 			case PT_DYNAMIC:
 			case PT_INTERP:
 			case PT_SHLIB:
-				goto done;
+				goto error;
 			case PT_LOAD:
 				if (validate_segment (&phdr, file)) {
-					bool writable = (phdr.p_flags & PF_W) != 0;
-					uint64_t file_page = phdr.p_offset & ~PGMASK;
-					uint64_t mem_page = phdr.p_vaddr & ~PGMASK;
+					struct exec_segment *seg = &image->segs[image->seg_cnt++];
 					uint64_t page_offset = phdr.p_vaddr & PGMASK;
-					uint32_t read_bytes, zero_bytes;
+
+					seg->writable = (phdr.p_flags & PF_W) != 0;
+					seg->file_page = phdr.p_offset & ~PGMASK;
+					seg->mem_page = phdr.p_vaddr & ~PGMASK;
 					if (phdr.p_filesz > 0) {
 						/* Normal segment.
 						 * Read initial part from disk and zero the rest. */
-						read_bytes = page_offset + phdr.p_filesz;
-						zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
-								- read_bytes);
+						seg->read_bytes = page_offset + phdr.p_filesz;
+						seg->zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
+								- seg->read_bytes);
 					} else {
 						/* Entirely zero.
 						 * Don't read anything from disk. */
-						read_bytes = 0;
-						zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
+						seg->read_bytes = 0;
+						seg->zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
 					}
-					if (!load_segment (file, file_page, (void *) mem_page,
-								read_bytes, zero_bytes, writable))
-						goto done;
 				}
 				else
-					goto done;
+					goto error;
 				break;
 		}
 	}
+	return image;
+
+error:
+	free (image);
+	return NULL;
+}
+
+/* Loads an ELF executable from FILE_NAME into the current thread.
+ * Stores the executable's entry point into *RIP
+ * and its initial stack pointer into *RSP.
+ * If FILE_NAME is a checkpoint image instead, resumes the process
+ * saved in it with all of IF_ and sets *RESTORED.
+ * Returns true if successful, false otherwise. */
+static bool
+load (const char *file_name, struct intr_frame *if_, bool *restored) {
+	struct thread *t = thread_current ();
+	struct exec_image *image;
+	struct file *file = NULL;
+	bool success = false;
+	int i;
+
+	/* Allocate and activate page directory. */
+	t->pml4 = pml4_create ();
+	if (t->pml4 == NULL)
+		goto done;
+	process_activate (thread_current ());
+
+	/* Open executable file. */
+	file = filesys_open (file_name);
+	if (file == NULL) {
+		printf ("load: %s: open failed\n", file_name);
+		goto done;
+	}
+
+	/* Reuse the parsed headers of a recently executed binary, and
+	 * only read them from disk when the binary is new or changed.
+	 * Checkpoint images are never cached, so only a miss can be
+	 * one. */
+	image = exec_cache_lookup (file);
+	if (image == NULL) {
+#ifdef VM
+		if (checkpoint_is_image (file)) {
+			if (!checkpoint_restore (file, if_))
+				goto done;
+			t->exec_file = file;
+			file_deny_write (file);
+			*restored = true;
+			success = true;
+			goto done;
+		}
+#endif
+		image = exec_image_parse (file, file_name);
+		if (image == NULL)
+			goto done;
+		inode_reopen (image->inode);
+		exec_cache_insert (image);
+	}
+
+	for (i = 0; i < image->seg_cnt; i++) {
+		struct exec_segment *seg = &image->segs[i];
+		if (!load_segment (file, seg->file_page, (void *) seg->mem_page,
+					seg->read_bytes, seg->zero_bytes, seg->writable))
+			goto done;
+	}
 	/* file_deny_write*/
 	t->exec_file=file;
     file_deny_write(file);
@@ -612,10 +833,7 @@ load (const char *file_name, struct intr_frame *if_) {
 		goto done;
 
 	/* Start address. */
-	if_->rip = ehdr.e_entry;
-
-	/* TODO: Your code goes here.
-	 * TODO: Implement argument passing (see project2/argument_passing.html). */
+	if_->rip = image->entry;
 
 	success = true;
 
@@ -785,15 +1003,22 @@ lazy_load_segment (struct page *page, void *aux) {
     /* TODO: This called when the first page fault occurs on address VA. */
     /* TODO: VA is available when calling this function. */
 
-   struct lazy_load_info *lazy_load_info = (struct lazy_load_info *)aux;
-	file_seek(lazy_load_info->file, lazy_load_info->offset);
-	if (file_read(lazy_load_info->file, page->frame->kva, lazy_load_info->read_bytes) != (int)(lazy_load_info->read_bytes))
-	{	
-		palloc_free_page(page->frame->kva);
+	/* AUX may describe a whole segment that starts at its UPAGE, so
+	 * work out which part of it falls into this page. */
+	struct lazy_load_info *lazy_load_info = (struct lazy_load_info *)aux;
+	size_t page_idx = ((uint8_t *) page->va - lazy_load_info->upage) / PGSIZE;
+	size_t skipped = page_idx * PGSIZE;
+	size_t read_bytes = 0;
+
+	if (lazy_load_info->read_bytes > skipped)
+		read_bytes = lazy_load_info->read_bytes - skipped < PGSIZE
+			? lazy_load_info->read_bytes - skipped : PGSIZE;
+
+	if (file_read_at (lazy_load_info->file, page->frame->kva, read_bytes,
+				lazy_load_info->offset + skipped) != (int) read_bytes)
 		return false;
-	}
 	// printf("lazy_load_segment : file_read success\n");
-	memset(page->frame->kva + lazy_load_info->read_bytes, 0, lazy_load_info->zero_bytes);
+	memset(page->frame->kva + read_bytes, 0, PGSIZE - read_bytes);
 	// free(lazy_load_info);
 
 	return true;
@@ -858,6 +1083,18 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 	ASSERT (pg_ofs (upage) == 0);
 	ASSERT (ofs % PGSIZE == 0);
 
+	/* One aux describes the whole segment; lazy_load_segment() finds
+	 * each page's share of it from the page's address. */
+	struct lazy_load_info *lazy_load_info = (struct lazy_load_info *)malloc(sizeof(struct lazy_load_info));
+	if (lazy_load_info == NULL)
+		return false;
+	lazy_load_info->file = file;
+	lazy_load_info->upage = upage;
+	lazy_load_info->offset = ofs;
+	lazy_load_info->read_bytes = read_bytes;
+	lazy_load_info->zero_bytes = zero_bytes;
+	lazy_load_info->writable = writable;
+
 	while (read_bytes > 0 || zero_bytes > 0) {
 		/* Do calculate how to fill this page.
 		 * We will read PAGE_READ_BYTES bytes from FILE
@@ -866,27 +1103,14 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
 		size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
-		/* TODO: Set up aux to pass information to the lazy_load_segment. */
-		struct lazy_load_info* lazy_load_info = (struct lazy_load_info *)malloc(sizeof(struct lazy_load_info));
-        
-        lazy_load_info->file = file;
-        lazy_load_info->offset = ofs;
-        lazy_load_info->read_bytes = page_read_bytes;
-		lazy_load_info->zero_bytes = page_zero_bytes;
-        lazy_load_info->writable = writable;
-
-
-		//void *aux = NULL;
 		if (!vm_alloc_page_with_initializer (VM_ANON, upage,
 					writable, lazy_load_segment, lazy_load_info))
-			// free(&lazy_load_info);
 			return false;
 
 		/* Advance. */
 		read_bytes -= page_read_bytes;
 		zero_bytes -= page_zero_bytes;
 		upage += PGSIZE;
-		ofs += page_read_bytes;
 	}
 	return true;
 }
@@ -905,14 +1129,16 @@ setup_stack (struct intr_frame *if_) {
 	 * TODO: If success, set the rsp accordingly.
 	 * TODO: You should mark the page is stack. */
 	/* TODO: Your code goes here */
-	if (vm_alloc_page(VM_ANON | VM_MARKER_0, stack_bottom, 1))
+	if (vm_alloc_page(VM_ANON | VM_STACK, stack_bottom, 1))
 	// writable: argument_stack()에서 값을 넣어야 하니 True
 	{
 		// 2) 할당 받은 페이지에 바로 물리 프레임을 매핑한다.
 		success = vm_claim_page(stack_bottom);
-		if (success)
+		if (success) {
 			// 3) rsp를 변경한다. (argument_stack에서 이 위치부터 인자를 push한다.)
 			if_->rsp = USER_STACK;
+			thread_current ()->stack_bottom = stack_bottom;
+		}
 	}
 	return success;
 }
@@ -1,5 +1,6 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
@@ -10,12 +11,14 @@
 #include "intrinsic.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/directory.h"
 #include "threads/vaddr.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "devices/input.h"
 #include "lib/kernel/stdio.h"
 #include "vm/vm.h"
+#include "vm/checkpoint.h"
 
 // struct lock filesys_lock;
 void syscall_entry (void);
@@ -34,6 +37,10 @@ void syscall_handler (struct intr_frame *);
 #define MSR_LSTAR 0xc0000082        /* Long mode SYSCALL target */
 #define MSR_SYSCALL_MASK 0xc0000084 /* Mask for the eflags */
 
+/* Most bytes of a read() or write() buffer pinned at once, so that
+ * a buffer larger than free memory cannot pin every frame. */
+#define IO_CHUNK (16 * PGSIZE)
+
 void
 syscall_init (void) {
 	write_msr(MSR_STAR, ((uint64_t)SEL_UCSEG - 0x10) << 48  |
@@ -46,7 +53,7 @@ syscall_init (void) {
 	write_msr(MSR_SYSCALL_MASK,
 			FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
 
-	lock_init(&filesys_lock);
+	rwlock_init(&filesys_lock);
 }
 
 // void check_addr(char *addr){
@@ -120,6 +127,33 @@ syscall_handler (struct intr_frame *f UNUSED) {
 	case SYS_MUNMAP:
 		munmap(f->R.rdi);
 		break;
+	case SYS_STACK_RESERVE:
+		f->R.rax = stack_reserve(f->R.rdi, f->R.rsi);
+		break;
+	case SYS_RSS_LIMIT:
+		f->R.rax = rss_limit(f->R.rdi);
+		break;
+	case SYS_VMSTAT:
+		f->R.rax = vmstat(f->R.rdi);
+		break;
+	case SYS_FAULT_LATENCY:
+		f->R.rax = fault_latency(f->R.rdi, f->R.rsi);
+		break;
+	case SYS_MEMMAP:
+		f->R.rax = memmap(f->R.rdi, f->R.rsi);
+		break;
+	case SYS_CHECKPOINT:
+		f->R.rax = checkpoint(f->R.rdi, f);
+		break;
+	case SYS_SHM_OPEN:
+		f->R.rax = shm_open(f->R.rdi, f->R.rsi);
+		break;
+	case SYS_SHM_MAP:
+		f->R.rax = shm_map(f->R.rdi, f->R.rsi);
+		break;
+	case SYS_SHM_UNLINK:
+		f->R.rax = shm_unlink(f->R.rdi);
+		break;
 	    
 	}
 }
@@ -194,6 +228,111 @@ void munmap (void *addr){
 	do_munmap(addr);
 }
 
+/* Sets how far the stack may grow below USER_STACK and how many
+ * bytes below a faulting stack address to map ahead of time. */
+bool stack_reserve (size_t limit, size_t prefault){
+	return vm_set_stack_limit(limit, prefault);
+}
+
+/* Caps the resident set of the process at LIMIT bytes, 0 meaning no
+ * cap.  The cap survives exec and is inherited by fork. */
+bool rss_limit (size_t limit){
+	return vm_set_rss_limit(limit);
+}
+
+/* Copies a snapshot of the system-wide VM counters to STAT. */
+bool vmstat (struct vmstat *stat){
+	struct vmstat snapshot;
+
+	if (!vm_pin_range(stat, sizeof *stat, true))
+		exit(-1);
+	vm_get_stat(&snapshot);
+	memcpy(stat, &snapshot, sizeof *stat);
+	vm_unpin_range(stat, sizeof *stat);
+	return true;
+}
+
+/* Copies the page fault latency histograms to HIST: the calling
+ * process's, or those of every process if ALL. */
+bool fault_latency (struct fault_hist *hist, bool all){
+	if (!vm_pin_range(hist, sizeof *hist, true))
+		exit(-1);
+	vm_get_fault_hist(hist, all);
+	vm_unpin_range(hist, sizeof *hist);
+	return true;
+}
+
+/* Fills REGIONS with up to MAX regions of the calling process's
+ * memory map, in address order.  Returns the number of regions in
+ * the map, which may be more than MAX, or -1 on failure. */
+int memmap (struct mem_region *regions, int max){
+	int region_cnt;
+
+	if (max < 0)
+		return -1;
+	if (!vm_pin_range(regions, max * sizeof *regions, true))
+		exit(-1);
+	region_cnt = vm_get_regions(regions, max);
+	vm_unpin_range(regions, max * sizeof *regions);
+	return region_cnt;
+}
+
+/* Saves the calling process to a new file named FILE.  Returns 0,
+ * or -1 on failure; executing FILE later resumes the process from
+ * here with a return value of 1. */
+int checkpoint (const char *file, struct intr_frame *f){
+	char name[NAME_MAX + 1];
+
+	if(!check_addr(file))
+		exit(-1);
+	/* 이름을 먼저 커널로 복사해 filesys_lock을 쥔 채 폴트가 나지 않게 한다 */
+	if (strnlen(file, sizeof name) > NAME_MAX)
+		return -1;
+	strlcpy(name, file, sizeof name);
+	return checkpoint_save(name, f);
+}
+
+/* Copies the user string NAME into BUF, SHM_NAME_MAX + 1 bytes, so
+ * that no fault happens while shm_lock is held.  Returns false if
+ * NAME is empty or too long. */
+static bool copy_shm_name (char *buf, const char *name){
+	size_t len;
+
+	if(!check_addr(name))
+		exit(-1);
+	len = strnlen(name, SHM_NAME_MAX + 1);
+	if (len == 0 || len > SHM_NAME_MAX)
+		return false;
+	strlcpy(buf, name, SHM_NAME_MAX + 1);
+	return true;
+}
+
+/* Returns the id of the shared memory object NAME, creating it with
+ * SIZE bytes of zeros if it does not exist, or -1 on failure. */
+int shm_open (const char *name, size_t size){
+	char buf[SHM_NAME_MAX + 1];
+
+	if (!copy_shm_name(buf, name))
+		return -1;
+	return shm_create(buf, size);
+}
+
+/* Maps the shared memory object SHMID at ADDR.  munmap() removes the
+ * mapping. */
+void *shm_map (int shmid, void *addr){
+	return shm_attach(shmid, addr);
+}
+
+/* Removes the name of the shared memory object NAME; it is freed
+ * when its last mapping goes away. */
+bool shm_unlink (const char *name){
+	char buf[SHM_NAME_MAX + 1];
+
+	if (!copy_shm_name(buf, name))
+		return false;
+	return shm_remove(buf);
+}
+
 void halt (void)
 {
 	power_off();
@@ -312,20 +451,26 @@ void del_fd(int fd){
 bool create (const char *file, unsigned initial_size){
 	if(!check_addr(file))
 		exit(-1);
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_write(&filesys_lock);
 	// if(strlen(file) >= 511)
 	// 	return 0;
 	bool success = filesys_create(file,initial_size);
-	lock_release(&filesys_lock);
+	rwlock_release_write(&filesys_lock);
 	return success;
 }
 
 bool remove (const char *file){
 	if(!check_addr(file))
 		exit(-1);
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_write(&filesys_lock);
+	/* exec 캐시가 inode를 열어 두면 삭제해도 블록이 해제되지 않으므로 먼저 버린다 */
+	struct file *f = filesys_open(file);
+	if (f != NULL){
+		exec_cache_forget(file_get_inode(f));
+		file_close(f);
+	}
 	bool success = filesys_remove(file);
-	lock_release(&filesys_lock);
+	rwlock_release_write(&filesys_lock);
 	return success;
 }
 
@@ -334,17 +479,17 @@ int open (const char *file){
 	if(!check_addr(file))
 		exit(-1);
 
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_write(&filesys_lock);
 	struct file *f = filesys_open(file);
 
 	if (f == NULL){
-	lock_release(&filesys_lock);
+	rwlock_release_write(&filesys_lock);
 		return -1;}
 
 	int fd = create_fd(f);
 	if (fd == -1)
 		file_close(f);
-	lock_release(&filesys_lock);
+	rwlock_release_write(&filesys_lock);
 	return fd;
 }
 
@@ -359,45 +504,42 @@ int read (int fd, void *buffer, unsigned length){
 	if(!check_addr(buffer))
 			exit(-1);
 	// printf("syscall_read fd: %d, buffer: %p, length: %d\n", fd, buffer, length);
-	struct page *page = spt_find_page(&thread_current()->spt, buffer);
-	// printf("[syscall_read] page 1: %p\n", page);
-	// printf("[syscall_read] page type: %d\n", page->operations->type);
-	// if (page == NULL){
-	// 	exit(-1);
-	// }
+	struct file *file = fd < 2 ? NULL : find_file_by_fd(fd);
+	if (fd != 0 && file == NULL)
+		return -1;
 
-	if (page && !page->writable){
-			exit(-1);
-		}
-	// printf("[syscall_read] page 2: %p\n", page);
+	/* 버퍼를 IO_CHUNK씩 올려 고정해 두면 filesys_lock 안에서 page fault가 나지 않고,
+	 * 큰 버퍼가 모든 프레임을 붙잡지도 않는다 */
 	char *ptr = (char *)buffer;
-	int bytes_read = 0;
-
-	if (fd == 0){
-		for (int i = 0; i < length; i++){
-			char ch = input_getc();
-			if (ch == '\n'){
-				break;
-			}
-			*ptr = ch;
-            ptr++;
-			bytes_read++;
+	unsigned bytes_read = 0;
+	while (bytes_read < length){
+		unsigned chunk = length - bytes_read < IO_CHUNK ? length - bytes_read : IO_CHUNK;
+		unsigned n = 0;
+
+		if (!vm_pin_range(ptr, chunk, true)){
+			if (bytes_read == 0)
+				exit(-1);
+			break;
+		}
+		if (fd == 0){
+			for (; n < chunk; n++){
+				char ch = input_getc();
+				if (ch == '\n')
+					break;
+				ptr[n] = ch;
 			}
 		}
-	// }
-	else{
-		if (fd < 2)
-				return -1;
-		struct file *file = find_file_by_fd(fd);
-		if (file == NULL){
-			return -1;
+		else{
+			rwlock_acquire_read(&filesys_lock);
+			n = file_read(file, ptr, chunk);
+			rwlock_release_read(&filesys_lock);
 		}
-		// printf("[syscall_read] file_read start\n");
-		lock_acquire(&filesys_lock);
-		bytes_read = file_read(file,buffer,length);
-		lock_release(&filesys_lock);
-		// printf("[syscall_read] file_read end - bytes_read : %d\n",bytes_read);
-}
+		vm_unpin_range(ptr, chunk);
+		ptr += n;
+		bytes_read += n;
+		if (n < chunk)
+			break;
+	}
 	return bytes_read;
 }
 
@@ -405,30 +547,35 @@ int read (int fd, void *buffer, unsigned length){
 int write (int fd, const void *buffer, unsigned length){
 	if(check_addr(buffer) == 0)
 		exit(-1);
-	// 	struct page *page = spt_find_page(&thread_current()->spt, buffer);
-	// if (page == NULL){
-	// 	exit(-1);
-	// }
-	// if (page && !page->writable){
-	// 		exit(-1);
-	// 	}
-	int bytes_written = 0;
-	if (fd == 1){
-		//lock_acquire(&filesys_lock);
-		putbuf(buffer,length);
-		//lock_release(&filesys_lock);
-		bytes_written = length;
-	}
-	else
-	{
-		if (fd < 2)
-			return -1;
-		struct file *file = find_file_by_fd(fd);
-		if (file == NULL)
-			return -1;
-		lock_acquire(&filesys_lock);
-		bytes_written = file_write(file,buffer,length);
-		lock_release(&filesys_lock);
+	struct file *file = fd < 2 ? NULL : find_file_by_fd(fd);
+	if (fd != 1 && file == NULL)
+		return -1;
+
+	const char *ptr = buffer;
+	unsigned bytes_written = 0;
+	while (bytes_written < length){
+		unsigned chunk = length - bytes_written < IO_CHUNK ? length - bytes_written : IO_CHUNK;
+		unsigned n;
+
+		if (!vm_pin_range(ptr, chunk, false)){
+			if (bytes_written == 0)
+				exit(-1);
+			break;
+		}
+		if (fd == 1){
+			putbuf(ptr, chunk);
+			n = chunk;
+		}
+		else{
+			rwlock_acquire_write(&filesys_lock);
+			n = file_write(file, ptr, chunk);
+			rwlock_release_write(&filesys_lock);
+		}
+		vm_unpin_range(ptr, chunk);
+		ptr += n;
+		bytes_written += n;
+		if (n < chunk)
+			break;
 	}
 	return bytes_written;
 }
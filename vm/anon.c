@@ -42,6 +42,7 @@ bool anon_initializer(struct page *page, enum vm_type type, void *kva)
     // anon_page->sec_no = SIZE_MAX;
     anon_page->sec_no = -1;
     anon_page->thread = thread_current();
+    anon_page->stack = (type & VM_STACK) != 0;
 
     return true;
 }
@@ -72,7 +73,11 @@ anon_swap_in(struct page *page, void *kva)
 
     lock_acquire(&bitmap_lock);
     bitmap_set_multiple(disk_bitmap, anon_page->sec_no, 8, false);
+    page->owner->swap_cnt--;
     lock_release(&bitmap_lock);
+    anon_page->sec_no = -1;
+    vm_stat_add(swap_slots_used, -1);
+    vm_stat_add(swap_ins, 1);
 
     return true;
 }
@@ -84,8 +89,15 @@ anon_swap_out(struct page *page)
     // printf("anon_swap_out\n");
     struct anon_page *anon_page = &page->anon;
 
+    // 다른 프로세스와 나눠 쓰는 페이지 테이블은 미리 떼어 낸다.
+    // 메모리가 모자라면 이 페이지는 두고 다른 희생자를 고르게 한다
+    if (!pml4_unshare(anon_page->thread->pml4, page->va))
+        return false;
+
     lock_acquire(&bitmap_lock);
     disk_sector_t sec_no = (disk_sector_t)bitmap_scan_and_flip(disk_bitmap, 0, 8, false);
+    if (sec_no != BITMAP_ERROR)
+        page->owner->swap_cnt++;
     lock_release(&bitmap_lock);
     if (sec_no == BITMAP_ERROR)
         return false;
@@ -96,39 +108,109 @@ anon_swap_out(struct page *page)
         disk_write(swap_disk, sec_no + i, page->frame->kva + i * DISK_SECTOR_SIZE);
     }
     anon_page->sec_no = sec_no;
+    vm_stat_add(swap_slots_used, 1);
+    vm_stat_add(swap_outs, 1);
 
     pml4_clear_page(anon_page->thread->pml4, page->va);
     pml4_set_dirty(anon_page->thread->pml4, page->va, false);
+    // 다른 프로세스의 페이지 테이블은 그 주인이 pml4_set_page() 중일 수 있으니 건드리지 않는다
+    if (anon_page->thread == thread_current())
+        pml4_reclaim(anon_page->thread->pml4, page->va, PGSIZE);
     page->frame = NULL;
 
     return true;
 }
 
-/* Destroy the anonymous page. PAGE will be freed by the caller. */
-static void
-anon_destroy(struct page *page)
+/* Gives DST its own copy of the swap slot holding SRC, which must
+ * be swapped out.  Used by fork. */
+bool anon_swap_dup(struct page *dst, struct page *src)
 {
-    struct anon_page *anon_page = &page->anon;
-    if (page->frame != NULL)
+    void *buf;
+
+    if (src->anon.sec_no == -1)
+        return false;
+    buf = palloc_get_page(0);
+    if (buf == NULL)
+        return false;
+
+    lock_acquire(&bitmap_lock);
+    disk_sector_t sec_no = (disk_sector_t)bitmap_scan_and_flip(disk_bitmap, 0, 8, false);
+    if (sec_no != BITMAP_ERROR)
+        dst->owner->swap_cnt++;
+    lock_release(&bitmap_lock);
+    if (sec_no == BITMAP_ERROR)
     {
-        // printf("anon_destroy: %s\n", thread_current()->name);
-        // printf("remove: %p, kva:%p\n", page->va, page->frame->kva);
-        // printf("list_size: %d, list: %p\n", list_size(&frame_table), &frame_table);
+        palloc_free_page(buf);
+        return false;
+    }
 
-        lock_acquire(&frame_table_lock);
-        list_remove(&page->frame->frame_elem);
-        lock_release(&frame_table_lock);
+    for (int i = 0; i < 8; i++)
+        disk_read(swap_disk, src->anon.sec_no + i, buf + i * DISK_SECTOR_SIZE);
+    for (int i = 0; i < 8; i++)
+        disk_write(swap_disk, sec_no + i, buf + i * DISK_SECTOR_SIZE);
+    dst->anon.sec_no = sec_no;
+    vm_stat_add(swap_slots_used, 1);
 
-        // printf("anon_destroy: list: %p\n", &frame_table);
+    palloc_free_page(buf);
+    return true;
+}
 
-        // pte write bit 1 -> free
-        free(page->frame);
-        // printf("anon_destory: list: %p\n",&page->frame);
-    }
+/* Reserves a free swap slot and returns its first sector, or -1 if
+ * swap is full.  For memory that no single process owns, such as
+ * shared memory objects. */
+int anon_swap_alloc(void)
+{
+    lock_acquire(&bitmap_lock);
+    disk_sector_t sec_no = (disk_sector_t)bitmap_scan_and_flip(disk_bitmap, 0, 8, false);
+    lock_release(&bitmap_lock);
+    if (sec_no == BITMAP_ERROR)
+        return -1;
+    vm_stat_add(swap_slots_used, 1);
+    return sec_no;
+}
+
+/* Writes the page at KVA to the swap slot at SEC_NO, which
+ * anon_swap_alloc() reserved. */
+void anon_swap_write(int sec_no, const void *kva)
+{
+    for (int i = 0; i < 8; i++)
+        disk_write(swap_disk, sec_no + i, kva + i * DISK_SECTOR_SIZE);
+    vm_stat_add(swap_outs, 1);
+}
+
+/* Reads the swap slot at SEC_NO into KVA and frees the slot. */
+void anon_swap_read(int sec_no, void *kva)
+{
+    for (int i = 0; i < 8; i++)
+        disk_read(swap_disk, sec_no + i, kva + i * DISK_SECTOR_SIZE);
+    anon_swap_free(sec_no);
+    vm_stat_add(swap_ins, 1);
+}
+
+/* Frees the swap slot at SEC_NO without reading it. */
+void anon_swap_free(int sec_no)
+{
+    lock_acquire(&bitmap_lock);
+    bitmap_set_multiple(disk_bitmap, sec_no, 8, false);
+    lock_release(&bitmap_lock);
+    vm_stat_add(swap_slots_used, -1);
+}
+
+/* Destroy the anonymous page. PAGE will be freed by the caller. */
+static void
+anon_destroy(struct page *page)
+{
+    struct anon_page *anon_page = &page->anon;
+    /* fork로 공유 중인 프레임은 마지막 페이지가 사라질 때 해제된다. */
+    vm_frame_release(page);
     // if (anon_page->sec_no != SIZE_MAX){
         if (anon_page->sec_no != -1){
     // printf("anon_destroy: anon_page->sec_no: %d\n",anon_page->sec_no);
+        lock_acquire(&bitmap_lock);
         bitmap_set_multiple(disk_bitmap, anon_page->sec_no, 8, false);
+        page->owner->swap_cnt--;
+        lock_release(&bitmap_lock);
+        vm_stat_add(swap_slots_used, -1);
         // printf("annon_destory : bitmap_set_multiple done\n");
     }
 }
\ No newline at end of file
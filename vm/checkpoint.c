@@ -0,0 +1,408 @@
+/* checkpoint.c: Saving a process to a file and resuming it from one.
+ *
+ * A checkpoint image is a header with the process's registers, one
+ * record per page of its SPT, one record per open file, and then the
+ * contents of every anonymous page, page aligned, in the order of
+ * their records.  Executing an image maps those pages lazily from it,
+ * so a restored process only reads the pages it touches.  Files are
+ * recorded by name and looked up again on restore, so an image can
+ * only reach files that its user could open anyway. */
+
+#include <round.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "filesys/inode.h"
+#include "threads/flags.h"
+#include "threads/loader.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "userprog/process.h"
+#include "userprog/syscall.h"
+#include "vm/checkpoint.h"
+#include "vm/vm.h"
+
+/* Identifies a checkpoint image ("PINTCKPT"). */
+#define CKPT_MAGIC 0x54504b43544e4950ULL
+
+/* Anonymous pages gathered into each write of the image. */
+#define CKPT_BATCH 16
+
+/* Start of an image. */
+struct ckpt_header {
+	uint64_t magic;             /* CKPT_MAGIC. */
+	uint32_t page_cnt;          /* Number of page records. */
+	uint32_t fd_cnt;            /* Number of file records. */
+	uint64_t stack_bottom;      /* Lowest mapped stack page. */
+	uint64_t stack_floor;       /* Stack may not grow below this. */
+	struct intr_frame tf;       /* User registers at the checkpoint. */
+};
+
+/* Where the contents of a page come from on restore. */
+enum ckpt_page_kind {
+	CKPT_ANON,                  /* The image itself. */
+	CKPT_FILE                   /* A mapped file. */
+};
+
+/* One page of the address space. */
+struct ckpt_page {
+	uint64_t va;                /* User virtual page. */
+	uint32_t kind;              /* enum ckpt_page_kind. */
+	uint32_t writable;          /* Writable by the process? */
+	uint32_t mmap_cnt;          /* Pages of the mapping it starts, or 0. */
+	uint32_t read_bytes;        /* CKPT_FILE: bytes read from the file. */
+	uint64_t offset;            /* Offset in the file, or in the image. */
+	char name[NAME_MAX + 1];    /* CKPT_FILE: name of the file. */
+};
+
+/* One open file descriptor. */
+struct ckpt_fd {
+	uint32_t fd;                /* Descriptor number. */
+	uint64_t pos;               /* Current position. */
+	char name[NAME_MAX + 1];    /* Name of the file. */
+};
+
+/* Stores in NAME the name under which FILE is in the root
+ * directory.  Returns false if FILE has been removed. */
+static bool
+ckpt_name (struct file *file, char name[NAME_MAX + 1]) {
+	disk_sector_t inumber = inode_get_inumber (file_get_inode (file));
+	struct dir *dir;
+	bool found = false;
+
+	rwlock_acquire_read (&filesys_lock);
+	dir = dir_open_root ();
+	while (!found && dir != NULL && dir_readdir (dir, name)) {
+		struct inode *inode;
+
+		if (dir_lookup (dir, name, &inode)) {
+			found = inode_get_inumber (inode) == inumber;
+			inode_close (inode);
+		}
+	}
+	dir_close (dir);
+	rwlock_release_read (&filesys_lock);
+	return found;
+}
+
+/* Fills REC with the description of PAGE, apart from where an
+ * anonymous page's contents go in the image.  Returns false if
+ * PAGE maps a file that has been removed. */
+static bool
+ckpt_describe (struct page *page, struct ckpt_page *rec) {
+	struct file *file;
+
+	memset (rec, 0, sizeof *rec);
+	rec->va = (uint64_t) page->va;
+	rec->writable = page->writable;
+	rec->mmap_cnt = page->mmap_cnt;
+	if (page_get_type (page) != VM_FILE) {
+		rec->kind = CKPT_ANON;
+		return true;
+	}
+
+	rec->kind = CKPT_FILE;
+	if (VM_TYPE (page->operations->type) == VM_UNINIT) {
+		struct lazy_load_info *info = page->uninit.aux;
+		file = info->file;
+		rec->offset = info->offset;
+		rec->read_bytes = info->read_bytes;
+	} else {
+		file = page->file.file;
+		rec->offset = page->file.offset;
+		rec->read_bytes = page->file.read_bytes;
+	}
+	return ckpt_name (file, rec->name);
+}
+
+/* Writes a resident, dirty file-backed PAGE back to its file, so
+ * that a restore reading the file sees what the process saw. */
+static bool
+ckpt_flush_file_page (struct page *page) {
+	uint64_t *pml4 = thread_current ()->pml4;
+
+	if (VM_TYPE (page->operations->type) != VM_FILE || page->frame == NULL)
+		return true;
+	if (!vm_pin_range (page->va, PGSIZE, false))
+		return false;
+	if (pml4_is_dirty (pml4, page->va)) {
+		rwlock_acquire_write (&filesys_lock);
+		file_write_at (page->file.file, page->va, page->file.read_bytes,
+				page->file.offset);
+		rwlock_release_write (&filesys_lock);
+		pml4_set_dirty (pml4, page->va, false);
+	}
+	vm_unpin_range (page->va, PGSIZE);
+	return true;
+}
+
+/* Writes SIZE bytes from BUFFER to IMAGE at OFS. */
+static bool
+ckpt_write (struct file *image, const void *buffer, off_t size, off_t ofs) {
+	off_t written;
+
+	rwlock_acquire_write (&filesys_lock);
+	written = file_write_at (image, buffer, size, ofs);
+	rwlock_release_write (&filesys_lock);
+	return written == size;
+}
+
+/* Saves the current process, whose registers at the checkpoint
+ * system call are F, into a new file named FILE_NAME.  Dirty pages
+ * of mapped files are written back, since a restore maps them from
+ * their files again; anonymous pages are copied into the image a
+ * batch at a time.  Returns 0, or -1 on failure, which includes an
+ * open or mapped file that has been removed and so has no name to
+ * record.  A process resumed from the image sees the call return 1. */
+int
+checkpoint_save (const char *file_name, struct intr_frame *f) {
+	struct thread *curr = thread_current ();
+	struct ckpt_header header;
+	struct ckpt_page *recs = NULL;
+	struct ckpt_fd *fds = NULL;
+	struct file *image = NULL;
+	struct page **pages;
+	uint8_t *batch = NULL;
+	size_t page_cnt, anon_cnt = 0, batch_cnt = 0, i;
+	off_t data_ofs, ofs;
+	int fd_cnt = 0, fd;
+	bool created = false;
+	int result = -1;
+
+	pages = spt_sorted_pages (&curr->spt, &page_cnt);
+	if (pages == NULL)
+		return -1;
+	for (fd = 2; fd < FDT_COUNT_LIMIT; fd++)
+		if (curr->fdt[fd] != NULL)
+			fd_cnt++;
+	recs = malloc (page_cnt * sizeof *recs + fd_cnt * sizeof *fds);
+	batch = palloc_get_multiple (PAL_ANY, CKPT_BATCH);
+	if (recs == NULL || batch == NULL)
+		goto done;
+	fds = (struct ckpt_fd *) (recs + page_cnt);
+
+	data_ofs = ROUND_UP (sizeof header + page_cnt * sizeof *recs
+			+ fd_cnt * sizeof *fds, PGSIZE);
+	for (i = 0; i < page_cnt; i++) {
+		if (!ckpt_describe (pages[i], &recs[i]))
+			goto done;
+		if (recs[i].kind == CKPT_ANON)
+			recs[i].offset = data_ofs + anon_cnt++ * PGSIZE;
+		else if (!ckpt_flush_file_page (pages[i]))
+			goto done;
+	}
+	for (fd = 2, i = 0; fd < FDT_COUNT_LIMIT; fd++) {
+		struct file *file = curr->fdt[fd];
+		if (file == NULL)
+			continue;
+		memset (&fds[i], 0, sizeof fds[i]);
+		fds[i].fd = fd;
+		fds[i].pos = file_tell (file);
+		if (!ckpt_name (file, fds[i].name))
+			goto done;
+		i++;
+	}
+
+	memset (&header, 0, sizeof header);
+	header.magic = CKPT_MAGIC;
+	header.page_cnt = page_cnt;
+	header.fd_cnt = fd_cnt;
+	header.stack_bottom = (uint64_t) curr->stack_bottom;
+	header.stack_floor = (uint64_t) curr->stack_floor;
+	header.tf = *f;
+	header.tf.R.rax = 1;
+
+	rwlock_acquire_write (&filesys_lock);
+	created = filesys_create (file_name, data_ofs + anon_cnt * PGSIZE);
+	if (created)
+		image = filesys_open (file_name);
+	rwlock_release_write (&filesys_lock);
+	if (image == NULL
+			|| !ckpt_write (image, &header, sizeof header, 0)
+			|| !ckpt_write (image, recs, page_cnt * sizeof *recs
+				+ fd_cnt * sizeof *fds, sizeof header))
+		goto done;
+
+	/* Copy each page in while it is pinned, then write whole batches
+	 * with filesys_lock held, so that bringing a page in never waits
+	 * on the lock this function holds. */
+	ofs = data_ofs;
+	for (i = 0; i < page_cnt; i++) {
+		if (recs[i].kind != CKPT_ANON)
+			continue;
+		if (!vm_pin_range (pages[i]->va, PGSIZE, false))
+			goto done;
+		memcpy (batch + batch_cnt * PGSIZE, pages[i]->va, PGSIZE);
+		vm_unpin_range (pages[i]->va, PGSIZE);
+		if (++batch_cnt == CKPT_BATCH) {
+			if (!ckpt_write (image, batch, batch_cnt * PGSIZE, ofs))
+				goto done;
+			ofs += batch_cnt * PGSIZE;
+			batch_cnt = 0;
+		}
+	}
+	if (batch_cnt > 0 && !ckpt_write (image, batch, batch_cnt * PGSIZE, ofs))
+		goto done;
+	result = 0;
+
+done:
+	rwlock_acquire_write (&filesys_lock);
+	file_close (image);
+	if (result != 0 && created)
+		filesys_remove (file_name);
+	rwlock_release_write (&filesys_lock);
+	palloc_free_multiple (batch, CKPT_BATCH);
+	free (recs);
+	free (pages);
+	return result;
+}
+
+/* Returns true if FILE is a checkpoint image. */
+bool
+checkpoint_is_image (struct file *file) {
+	uint64_t magic;
+
+	return file_read_at (file, &magic, sizeof magic, 0) == sizeof magic
+		&& magic == CKPT_MAGIC;
+}
+
+/* Opens the file called NAME, a name field read from an image. */
+static struct file *
+ckpt_open (const char name[NAME_MAX + 1]) {
+	if (memchr (name, '\0', NAME_MAX + 1) == NULL)
+		return NULL;
+	return filesys_open (name);
+}
+
+/* Returns true if HEADER's stack is one vm_set_stack_limit() and
+ * stack growth could have produced: a page-aligned bottom at or
+ * above a floor no more than STACK_LIMIT_MAX below USER_STACK. */
+static bool
+ckpt_stack_ok (const struct ckpt_header *header) {
+	return USER_STACK - STACK_LIMIT_MAX <= header->stack_floor
+		&& header->stack_floor <= header->stack_bottom
+		&& header->stack_bottom <= USER_STACK
+		&& pg_ofs ((void *) header->stack_floor) == 0
+		&& pg_ofs ((void *) header->stack_bottom) == 0;
+}
+
+/* Rebuilds the current process from IMAGE, which stays open for
+ * lazy loading, and stores the saved registers in IF_.  Anonymous
+ * pages stored back to back share one lazy_load_info, the way the
+ * pages of an executable's segment do.  Called from load() with
+ * filesys_lock held and a fresh, empty address space. */
+bool
+checkpoint_restore (struct file *image, struct intr_frame *if_) {
+	struct thread *curr = thread_current ();
+	struct ckpt_header header;
+	struct ckpt_page *recs;
+	struct ckpt_fd *fds;
+	struct lazy_load_info *run = NULL;
+	struct file *mapping = NULL;
+	off_t recs_size, fds_size;
+	bool success = false;
+	uint32_t i;
+
+	if (file_read_at (image, &header, sizeof header, 0) != sizeof header
+			|| header.page_cnt == 0 || header.page_cnt > USER_STACK / PGSIZE
+			|| header.fd_cnt > FDT_COUNT_LIMIT
+			|| !ckpt_stack_ok (&header))
+		return false;
+	recs_size = header.page_cnt * sizeof *recs;
+	fds_size = header.fd_cnt * sizeof *fds;
+	recs = malloc (recs_size + fds_size);
+	if (recs == NULL)
+		return false;
+	fds = (struct ckpt_fd *) (recs + header.page_cnt);
+	if (file_read_at (image, recs, recs_size + fds_size, sizeof header)
+			!= recs_size + fds_size)
+		goto done;
+
+	for (i = 0; i < header.page_cnt; i++) {
+		struct ckpt_page *rec = &recs[i];
+		uint8_t *upage = (uint8_t *) rec->va;
+		struct lazy_load_info *info;
+
+		if (upage == NULL || pg_ofs (upage) != 0 || !is_user_vaddr (upage))
+			goto done;
+		if (rec->kind == CKPT_ANON) {
+			if (run == NULL || upage != run->upage + run->read_bytes
+					|| rec->offset != (uint64_t) run->offset + run->read_bytes
+					|| rec->writable != run->writable) {
+				run = malloc (sizeof *run);
+				if (run == NULL)
+					goto done;
+				run->file = image;
+				run->upage = upage;
+				run->offset = rec->offset;
+				run->read_bytes = 0;
+				run->zero_bytes = 0;
+				run->writable = rec->writable;
+			}
+			run->read_bytes += PGSIZE;
+			if (!vm_alloc_page_with_initializer (
+						upage >= (uint8_t *) header.stack_bottom
+							? VM_ANON | VM_STACK : VM_ANON,
+						upage, rec->writable, lazy_load_segment, run))
+				goto done;
+			continue;
+		}
+
+		/* Each mapping gets a file of its own, as do_mmap() does. */
+		run = NULL;
+		if (rec->read_bytes > PGSIZE)
+			goto done;
+		if (rec->mmap_cnt != 0 || mapping == NULL) {
+			mapping = ckpt_open (rec->name);
+			if (mapping == NULL)
+				goto done;
+		}
+		info = malloc (sizeof *info);
+		if (info == NULL)
+			goto done;
+		info->file = mapping;
+		info->upage = upage;
+		info->offset = rec->offset;
+		info->read_bytes = rec->read_bytes;
+		info->zero_bytes = PGSIZE - rec->read_bytes;
+		info->writable = rec->writable;
+		if (!vm_alloc_page_with_initializer (VM_FILE, upage, rec->writable,
+					lazy_load_segment, info)) {
+			free (info);
+			goto done;
+		}
+		spt_find_page (&curr->spt, upage)->mmap_cnt = rec->mmap_cnt;
+	}
+
+	for (i = 0; i < header.fd_cnt; i++) {
+		struct ckpt_fd *rec = &fds[i];
+		struct file *file;
+
+		if (rec->fd < 2 || rec->fd >= FDT_COUNT_LIMIT)
+			goto done;
+		file = ckpt_open (rec->name);
+		if (file == NULL)
+			goto done;
+		file_seek (file, rec->pos);
+		if (curr->fdt[rec->fd] != NULL)
+			file_close (curr->fdt[rec->fd]);
+		curr->fdt[rec->fd] = file;
+	}
+
+	curr->stack_bottom = (void *) header.stack_bottom;
+	curr->stack_floor = (void *) header.stack_floor;
+
+	/* Resume in user mode whatever the image says. */
+	*if_ = header.tf;
+	if_->ds = if_->es = if_->ss = SEL_UDSEG;
+	if_->cs = SEL_UCSEG;
+	if_->eflags = FLAG_IF | FLAG_MBS;
+	success = true;
+
+done:
+	free (recs);
+	return success;
+}
@@ -63,9 +63,9 @@ file_backed_swap_in(struct page *page, void *kva)
     // printf("file_backed_swap_in\n");
     struct file_page *file_page = &page->file;
 
-    lock_acquire(&filesys_lock);
+    rwlock_acquire_read(&filesys_lock);
     off_t size = file_read_at(file_page->file, kva, (off_t)file_page->read_bytes, file_page->offset);
-    lock_release(&filesys_lock);
+    rwlock_release_read(&filesys_lock);
 
 	// printf("file_bakce_swap_in_ing\n");
 
@@ -86,18 +86,27 @@ static bool
 file_backed_swap_out(struct page *page)
 {
 	struct file_page *file_page UNUSED = &page->file;
-	if (pml4_is_dirty(thread_current()->pml4, page->va))
+	uint64_t *pml4 = page->owner->pml4;
+
+	// 내보내는 쪽은 다른 프로세스일 수 있으니 페이지 주인의 pml4를 쓴다.
+	// 공유 페이지 테이블을 떼어 낼 메모리가 없으면 다른 희생자를 고르게 한다
+	if (!pml4_unshare(pml4, page->va))
+		return false;
+	if (pml4_is_dirty(pml4, page->va))
 	{	
-		lock_acquire(&filesys_lock);
-		file_write_at(file_page->file, page->va, file_page->read_bytes, file_page->offset);
-		lock_release(&filesys_lock);
-		pml4_set_dirty(thread_current()->pml4, page->va, false);
+		rwlock_acquire_write(&filesys_lock);
+		off_t written = file_write_at(file_page->file, page->frame->kva, file_page->read_bytes, file_page->offset);
+		rwlock_release_write(&filesys_lock);
+		vm_stat_add(writeback_bytes, written);
+		pml4_set_dirty(pml4, page->va, false);
 	}
 
 	// 페이지와 프레임의 연결 끊기
 	page->frame->page = NULL;
 	page->frame = NULL;
-	pml4_clear_page(thread_current()->pml4, page->va);
+	pml4_clear_page(pml4, page->va);
+	if (page->owner == thread_current())
+		pml4_reclaim(pml4, page->va, PGSIZE);
 	return true;
 }
 
@@ -120,12 +129,14 @@ file_backed_destroy(struct page *page)
     // }
 	if (pml4_is_dirty(thread_current()->pml4, page->va))
 	{	
-		lock_acquire(&filesys_lock);
-		file_write_at(file_page->file, page->va, file_page->read_bytes, file_page->offset);
-		lock_release(&filesys_lock);
+		rwlock_acquire_write(&filesys_lock);
+		off_t written = file_write_at(file_page->file, page->va, file_page->read_bytes, file_page->offset);
+		rwlock_release_write(&filesys_lock);
+		vm_stat_add(writeback_bytes, written);
 		pml4_set_dirty(thread_current()->pml4, page->va, 0);
 	}
 	pml4_clear_page(thread_current()->pml4, page->va);
+	vm_frame_release(page);
 
     // // list_remove(&(file_page->file_elem));
 }
@@ -164,6 +175,7 @@ do_mmap (void *addr, size_t length, int writable,
 		struct lazy_load_info *lazy_load_info = (struct lazy_load_info *)malloc(sizeof(struct lazy_load_info));
 		// printf("lazy_load_info \n");
 		lazy_load_info->file = f;
+		lazy_load_info->upage = advance_addr;
 		lazy_load_info->offset = offset;
 		lazy_load_info->read_bytes = page_read_bytes;
 		lazy_load_info->zero_bytes = page_zero_bytes;
@@ -214,15 +226,17 @@ void
 do_munmap (void *addr) {
 	struct supplemental_page_table *spt = &thread_current()->spt;
 	struct page *p = spt_find_page(spt, addr);
+	void *start = addr;
 	int count = p->mmap_cnt;
 	for (int i = 0; i < count; i++)
 	{
 		if (p)
-			destroy(p);
-			// spt_remove_page(spt, p);
+			spt_remove_page(spt, p);
 
 		addr += PGSIZE;
 		p = spt_find_page(spt, addr);
 	}
+	/* 비게 된 페이지 테이블을 돌려준다 */
+	pml4_reclaim(thread_current()->pml4, start, (size_t) count * PGSIZE);
 }
 
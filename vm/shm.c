@@ -0,0 +1,362 @@
+/* shm.c: Named shared memory objects.
+ *
+ * An object is a run of anonymous pages that any number of processes
+ * map at once.  Each mapping process has its own VM_SHM pages in its
+ * SPT; while an object page is resident, every mapping of it shares
+ * one frame, and once evicted, the object keeps its swap slot. */
+
+#include <round.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/vm.h"
+
+/* One page of an object. */
+struct shm_slot {
+	struct frame *frame;        /* Frame it is in, or NULL. */
+	int sec_no;                 /* Swap slot it is in, or -1. */
+	void *kpage;                /* Kept here when swap was full, or NULL. */
+};
+
+/* A shared memory object. */
+struct shm_object {
+	struct list_elem elem;      /* Element in shm_objects. */
+	char name[SHM_NAME_MAX + 1];
+	int id;                     /* Identifier returned by shm_create(). */
+	int ref_cnt;                /* VM_SHM pages that map the object. */
+	bool unlinked;              /* Removed from shm_objects? */
+	size_t page_cnt;            /* Number of pages. */
+	struct shm_slot slots[];    /* One per page. */
+};
+
+/* Objects that have a name. */
+static struct list shm_objects;
+static int next_id;
+
+/* Guards the objects and their slots.  Taken before
+ * frame_table_lock, and never held across a page fault. */
+static struct lock shm_lock;
+
+static bool shm_swap_in (struct page *page, void *kva);
+static bool shm_swap_out (struct page *page);
+static void shm_destroy (struct page *page);
+
+static const struct page_operations shm_ops = {
+	.swap_in = shm_swap_in,
+	.swap_out = shm_swap_out,
+	.destroy = shm_destroy,
+	.type = VM_SHM,
+};
+
+/* Initializes the shared memory objects. */
+void
+vm_shm_init (void) {
+	list_init (&shm_objects);
+	lock_init (&shm_lock);
+	next_id = 0;
+}
+
+void
+shm_lock_acquire (void) {
+	lock_acquire (&shm_lock);
+}
+
+void
+shm_lock_release (void) {
+	lock_release (&shm_lock);
+}
+
+/* Returns the named object called NAME, or NULL. */
+static struct shm_object *
+shm_lookup (const char *name) {
+	struct list_elem *e;
+
+	for (e = list_begin (&shm_objects); e != list_end (&shm_objects);
+			e = list_next (e)) {
+		struct shm_object *obj = list_entry (e, struct shm_object, elem);
+		if (!strcmp (obj->name, name))
+			return obj;
+	}
+	return NULL;
+}
+
+/* Frees OBJ and its swap slots if it has neither a name nor a
+ * mapping left.  Caller must hold shm_lock. */
+static void
+shm_put (struct shm_object *obj) {
+	size_t i;
+
+	if (!obj->unlinked || obj->ref_cnt > 0)
+		return;
+	for (i = 0; i < obj->page_cnt; i++) {
+		if (obj->slots[i].sec_no != -1)
+			anon_swap_free (obj->slots[i].sec_no);
+		palloc_free_page (obj->slots[i].kpage);
+	}
+	free (obj);
+}
+
+/* Returns the identifier of the object called NAME, creating it
+ * with SIZE bytes of zeros if there is none.  Returns -1 if NAME is
+ * new and SIZE is 0, or if memory is short. */
+int
+shm_create (const char *name, size_t size) {
+	struct shm_object *obj;
+	size_t page_cnt = DIV_ROUND_UP (size, PGSIZE);
+	size_t i;
+	int id = -1;
+
+	lock_acquire (&shm_lock);
+	obj = shm_lookup (name);
+	if (obj != NULL)
+		id = obj->id;
+	else if (page_cnt > 0 && page_cnt <= USER_STACK / PGSIZE) {
+		obj = malloc (sizeof *obj + page_cnt * sizeof obj->slots[0]);
+		if (obj != NULL) {
+			strlcpy (obj->name, name, sizeof obj->name);
+			obj->id = id = next_id++;
+			obj->ref_cnt = 0;
+			obj->unlinked = false;
+			obj->page_cnt = page_cnt;
+			for (i = 0; i < page_cnt; i++) {
+				obj->slots[i].frame = NULL;
+				obj->slots[i].sec_no = -1;
+				obj->slots[i].kpage = NULL;
+			}
+			list_push_back (&shm_objects, &obj->elem);
+		}
+	}
+	lock_release (&shm_lock);
+	return id;
+}
+
+/* Adds a page at UPAGE to the current process that maps page IDX of
+ * OBJ.  Caller must hold shm_lock. */
+static struct page *
+shm_page_new (struct shm_object *obj, size_t idx, void *upage,
+		bool writable) {
+	struct page *page = malloc (sizeof *page);
+
+	if (page == NULL)
+		return NULL;
+	page->operations = &shm_ops;
+	page->va = upage;
+	page->frame = NULL;
+	page->writable = writable;
+	page->mmap_cnt = 0;
+	page->owner = thread_current ();
+	page->shm.obj = obj;
+	page->shm.idx = idx;
+	if (!spt_insert_page (&thread_current ()->spt, page)) {
+		free (page);
+		return NULL;
+	}
+	obj->ref_cnt++;
+	return page;
+}
+
+/* Maps the whole object ID, writable, at ADDR in the current process
+ * and returns ADDR, or NULL if ADDR is not a free, page-aligned user
+ * range.  munmap() of ADDR removes the mapping. */
+void *
+shm_attach (int id, void *addr) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct shm_object *obj = NULL;
+	struct list_elem *e;
+	uint8_t *upage;
+	size_t i;
+
+	if (addr == NULL || pg_ofs (addr) != 0)
+		return NULL;
+
+	lock_acquire (&shm_lock);
+	for (e = list_begin (&shm_objects); e != list_end (&shm_objects);
+			e = list_next (e))
+		if (list_entry (e, struct shm_object, elem)->id == id) {
+			obj = list_entry (e, struct shm_object, elem);
+			break;
+		}
+	if (obj == NULL || obj->page_cnt > (USER_STACK - (uint64_t) addr) / PGSIZE)
+		goto fail;
+	for (i = 0, upage = addr; i < obj->page_cnt; i++, upage += PGSIZE)
+		if (spt_find_page (spt, upage) != NULL
+				|| upage >= (uint8_t *) thread_current ()->stack_floor)
+			goto fail;
+
+	for (i = 0, upage = addr; i < obj->page_cnt; i++, upage += PGSIZE)
+		if (shm_page_new (obj, i, upage, true) == NULL) {
+			/* Undo by hand: shm_destroy() would take shm_lock again. */
+			while (i-- > 0) {
+				struct page *page = spt_find_page (spt, (uint8_t *) addr
+						+ i * PGSIZE);
+				hash_delete (&spt->spt_hash, &page->hash_elem);
+				obj->ref_cnt--;
+				free (page);
+			}
+			goto fail;
+		}
+	spt_find_page (spt, addr)->mmap_cnt = obj->page_cnt;
+	lock_release (&shm_lock);
+	return addr;
+
+fail:
+	lock_release (&shm_lock);
+	return NULL;
+}
+
+/* Removes the name NAME.  The object lives on until its last
+ * mapping goes away.  Returns false if there is no such object. */
+bool
+shm_remove (const char *name) {
+	struct shm_object *obj;
+
+	lock_acquire (&shm_lock);
+	obj = shm_lookup (name);
+	if (obj != NULL) {
+		list_remove (&obj->elem);
+		obj->unlinked = true;
+		shm_put (obj);
+	}
+	lock_release (&shm_lock);
+	return obj != NULL;
+}
+
+/* Adds a page to the current process that maps the same object page
+ * as SRC, for fork.  The caller shares SRC's frame, if any. */
+struct page *
+shm_page_dup (struct page *src) {
+	struct page *page;
+
+	lock_acquire (&shm_lock);
+	page = shm_page_new (src->shm.obj, src->shm.idx, src->va, src->writable);
+	if (page != NULL)
+		page->mmap_cnt = src->mmap_cnt;
+	lock_release (&shm_lock);
+	return page;
+}
+
+/* Returns the frame that the object page PAGE maps is in, or NULL.
+ * Caller must hold shm_lock. */
+struct frame *
+shm_get_frame (struct page *page) {
+	return page->shm.obj->slots[page->shm.idx].frame;
+}
+
+/* Returns true if the object page PAGE maps has contents outside a
+ * frame, in swap or kept aside by shm_destroy(). */
+bool
+shm_is_swapped (struct page *page) {
+	struct shm_slot *slot = &page->shm.obj->slots[page->shm.idx];
+
+	return slot->sec_no != -1 || slot->kpage != NULL;
+}
+
+/* Brings the object page PAGE maps into KVA, PAGE's new frame, from
+ * swap, from the page shm_destroy() kept, or as zeros.  Called by
+ * vm_do_claim_page() with shm_lock held once it knows that no other
+ * mapping has the page in a frame. */
+static bool
+shm_swap_in (struct page *page, void *kva) {
+	struct shm_slot *slot = &page->shm.obj->slots[page->shm.idx];
+
+	if (slot->sec_no != -1) {
+		anon_swap_read (slot->sec_no, kva);
+		slot->sec_no = -1;
+	} else if (slot->kpage != NULL) {
+		memcpy (kva, slot->kpage, PGSIZE);
+		palloc_free_page (slot->kpage);
+		slot->kpage = NULL;
+	} else
+		memset (kva, 0, PGSIZE);
+	slot->frame = page->frame;
+	return true;
+}
+
+/* Evicts the frame of PAGE, the first of the pages sharing it, to a
+ * swap slot of the object.  Every mapping loses its PTE before the
+ * write so that no process can change the page under it; the
+ * caller accounts for PAGE itself.  Returns false, with the frame
+ * still mapped everywhere, if swap is full or a page table cannot
+ * be unshared. */
+static bool
+shm_swap_out (struct page *page) {
+	struct shm_slot *slot = &page->shm.obj->slots[page->shm.idx];
+	struct frame *frame = page->frame;
+	struct list_elem *e;
+	int sec_no;
+
+	lock_acquire (&shm_lock);
+	sec_no = anon_swap_alloc ();
+	if (sec_no == -1) {
+		lock_release (&shm_lock);
+		return false;
+	}
+	lock_acquire (&frame_table_lock);
+	/* Unshare every mapper's page table first, so that running out
+	 * of memory leaves the frame mapped everywhere and the caller
+	 * can pick another victim. */
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages);
+			e = list_next (e)) {
+		struct page *p = list_entry (e, struct page, frame_page_elem);
+
+		if (!pml4_unshare (p->owner->pml4, p->va)) {
+			lock_release (&frame_table_lock);
+			anon_swap_free (sec_no);
+			lock_release (&shm_lock);
+			return false;
+		}
+	}
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages);
+			e = list_next (e)) {
+		struct page *p = list_entry (e, struct page, frame_page_elem);
+
+		pml4_clear_page (p->owner->pml4, p->va);
+		p->frame = NULL;
+		if (p != page) {
+			p->owner->rss_cnt--;
+			vm_stat_add (anon_resident, -1);
+		}
+	}
+	lock_release (&frame_table_lock);
+
+	anon_swap_write (sec_no, frame->kva);
+	slot->sec_no = sec_no;
+	slot->frame = NULL;
+	lock_release (&shm_lock);
+	return true;
+}
+
+/* Unmaps PAGE.  When it was the last mapping of a resident object
+ * page, the contents go to swap if the object outlives it, or stay
+ * in the frame's page, outside the frame table, if swap is full. */
+static void
+shm_destroy (struct page *page) {
+	struct shm_object *obj = page->shm.obj;
+	struct shm_slot *slot = &obj->slots[page->shm.idx];
+	bool keep = false;
+
+	lock_acquire (&shm_lock);
+	obj->ref_cnt--;
+	if (page->frame != NULL) {
+		pml4_clear_page (page->owner->pml4, page->va);
+		if (page->frame->ref_cnt == 1) {
+			if (!obj->unlinked || obj->ref_cnt > 0) {
+				slot->sec_no = anon_swap_alloc ();
+				if (slot->sec_no != -1)
+					anon_swap_write (slot->sec_no, page->frame->kva);
+				else
+					keep = true;
+			}
+			slot->frame = NULL;
+		}
+		if (keep)
+			slot->kpage = vm_frame_detach (page);
+		else
+			vm_frame_release (page);
+	}
+	shm_put (obj);
+	lock_release (&shm_lock);
+}
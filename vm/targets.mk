@@ -2,4 +2,6 @@ vm_SRC = vm/vm.c          # Main api proxy
 vm_SRC += vm/uninit.c     # Uninitialized page
 vm_SRC += vm/anon.c       # Anonymous page
 vm_SRC += vm/file.c       # File mapped page
+vm_SRC += vm/shm.c        # Shared memory object
 vm_SRC += vm/inspect.c    # Testing utility
+vm_SRC += vm/checkpoint.c # Process checkpoint and restore
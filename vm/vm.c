@@ -1,5 +1,10 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
+#include <round.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "intrinsic.h"
 #include "threads/malloc.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
@@ -9,6 +14,11 @@
 
 // struct list frame_table;
 
+static bool vm_migrate_frame (void *kva);
+static void vm_stat_resident (struct page *page, int delta);
+
+struct vmstat vm_stat;
+
 /* Returns a hash value for page p. */
 unsigned
 page_hash (const struct hash_elem *p_, void *aux UNUSED) {
@@ -53,6 +63,8 @@ vm_init (void) {
 	list_init(&frame_table);
 	lock_init(&frame_table_lock);
 	lock_init(&kill_lock);
+	palloc_set_migrator(vm_migrate_frame);
+	vm_shm_init();
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -70,9 +82,10 @@ page_get_type (struct page *page) {
 }
 
 /* Helpers */
-static struct frame *vm_get_victim (void);
+static struct frame *vm_get_victim (struct thread *owner);
 static bool vm_do_claim_page (struct page *page);
-static struct frame *vm_evict_frame (void);
+static struct frame *vm_evict_frame (struct thread *owner);
+static void fault_record (enum fault_class class, uint64_t start);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -120,6 +133,7 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		// printf("vm alloc with initializer uninit 성공\n");
 
 		page->writable = writable;
+		page->owner = thread_current();
 
 		if (!spt_insert_page(spt, page)) {
 			// printf("vm alloc with initializer insert 실패\n");
@@ -170,9 +184,29 @@ spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
 }
 
 struct list_elem* start;
+
+/* Returns true if FRAME may be evicted for OWNER, which limits the
+ * choice to OWNER's own frames unless it is a null pointer. */
+static bool
+frame_evictable (struct frame *frame, struct thread *owner) {
+	/* fork로 공유 중이거나 I/O에 고정된 프레임은 내보내지 않는다.
+	 * 공유 메모리 프레임은 shm_swap_out()이 모든 매핑을 함께 내린다 */
+	return (frame->ref_cnt <= 1 || page_get_type (frame->page) == VM_SHM)
+		&& frame->pin_cnt == 0
+		&& (owner == NULL || frame->page->owner == owner);
+}
+
+/* Returns how many cold sweeps a frame of OWNER survives: none for
+ * the lowest (or most niced) priority, up to EVICT_BIAS_MAX for the
+ * highest, so that low-priority threads give up their pages first. */
+static int
+evict_bias (struct thread *owner) {
+	return (owner->priority - PRI_MIN) * EVICT_BIAS_MAX / (PRI_MAX - PRI_MIN);
+}
+
 /* Get the struct frame, that will be evicted. */
 static struct frame *
-vm_get_victim (void) {
+vm_get_victim (struct thread *owner) {
 	struct frame *victim = NULL; /* victim = 교체 페이지 대상 */
 
 	/* lru_algorithm */
@@ -185,21 +219,39 @@ vm_get_victim (void) {
 	for (size_t i = 0; i < lru_len; i++)
 	{
 		tmp_frame = list_entry(e, struct frame, frame_elem); // 현재 리스트 요소에서 프레임 구조체를 추출한다
-		// 현재 페이지가 최근에 접근되었는지 확인
-		if (pml4_is_accessed(thread_current()->pml4, tmp_frame->page->va))
+		if (!frame_evictable(tmp_frame, owner))
+		{
+			e = list_next(e);
+			continue;
+		}
+		// 현재 페이지가 최근에 접근되었는지 확인 (페이지 주인의 pml4에서)
+		if (pml4_is_accessed(tmp_frame->page->owner->pml4, tmp_frame->page->va))
 		{
 			// 페이지가 최근에 접근된 경우, 접근 플래그를 false로 설정하고, 해당 프레임을 리스트의 끝으로 이동시킨다
-			pml4_set_accessed(thread_current()->pml4, tmp_frame->page->va, false);
+			pml4_set_accessed(tmp_frame->page->owner->pml4, tmp_frame->page->va, false);
+			tmp_frame->spared = 0;
 			next_tmp = list_next(e);
 			list_remove(e); // 현재 요소를 리스트에서 제거
 			list_push_back(&frame_table, e); // 제거된 요소를 리스트의 끝에 다시 추가
 			e = next_tmp; // 다음 요소로 이동
 			continue;
 		}
+		// 우선순위가 높은 스레드의 페이지는 차갑더라도 정해진 횟수만큼 더 봐준다
+		if (victim == NULL && tmp_frame->spared < evict_bias(tmp_frame->page->owner))
+		{
+			tmp_frame->spared++;
+			next_tmp = list_next(e);
+			list_remove(e);
+			list_push_back(&frame_table, e);
+			e = next_tmp;
+			continue;
+		}
 		// 교체 대상(victim)을 찾지 못했으면 현재 프레임을 교체 대상으로 설정
 		if (victim == NULL)
 		{
 			victim = tmp_frame;
+			if (owner == NULL)
+				vm_stat_add(evict_clock, 1);
 			next_tmp = list_next(e);
 			list_remove(e); // 교체 대상이 되는 프레임을 리스트에서 제거
 			e = next_tmp; // 다음 요소로 이동합
@@ -207,9 +259,18 @@ vm_get_victim (void) {
 		}
 		e = list_next(e); // 다음 요소로 이동
 	}
-	// 모든 프레임이 최근에 사용되었다면, 리스트의 첫 번째 프레임을 교체 대상으로 선택
-	if (victim == NULL)
-		victim = list_entry(list_pop_front(&frame_table), struct frame, frame_elem);
+	// 모든 프레임이 최근에 사용되었다면, 공유되지 않은 첫 번째 프레임을 교체 대상으로 선택
+	for (e = list_begin(&frame_table); victim == NULL && e != list_end(&frame_table); e = list_next(e))
+	{
+		tmp_frame = list_entry(e, struct frame, frame_elem);
+		if (frame_evictable(tmp_frame, owner))
+		{
+			victim = tmp_frame;
+			list_remove(e);
+			if (owner == NULL)
+				vm_stat_add(evict_fallback, 1);
+		}
+	}
 
 	// 이 부분은 멀티 스레딩 환경에서 프레임 테이블에 대한 동시 접근을 관리하기 위해 사용될 수 있다.
 	// lock_acquire(&frame_table_lock);
@@ -243,39 +304,78 @@ vm_get_victim (void) {
 	}
 
 /* Evict one page and return the corresponding frame.
+ * With OWNER, only OWNER's own pages are considered.
  * Return NULL on error.*/
 static struct frame *
-vm_evict_frame (void) {
+vm_evict_frame (struct thread *owner) {
+	uint64_t start = rdtsc ();
 
 	// printf("passed from vm_get_frame\n");
-	struct frame *victim = vm_get_victim ();
+	size_t tries = list_size (&frame_table);
+	struct frame *victim;
+	struct page *page;
 	/* TODO: swap out the victim and return the evicted frame. */
-	// if (victim->page)
-	swap_out(victim->page);
+	for (;;) {
+		victim = vm_get_victim (owner);
+		if (victim == NULL)
+			return NULL;
+		page = victim->page;
+		if (swap_out (page))
+			break;
+		/* 스왑이 가득 찼거나 페이지 테이블을 떼어 낼 메모리가 없으면
+		 * 프레임은 그대로 두고 다른 희생자를 고른다 */
+		list_push_back (&frame_table, &victim->frame_elem);
+		if (--tries == 0)
+			return NULL;
+	}
+	if (owner != NULL)
+		vm_stat_add(evict_local, 1);
+	lock_acquire(&frame_table_lock);
+	page->owner->rss_cnt--;
+	vm_stat_resident(page, -1);
+	lock_release(&frame_table_lock);
+	victim->page = NULL;
+	list_init(&victim->pages);
+	victim->ref_cnt = 0;
+	victim->pin_cnt = 0;
+	victim->spared = 0;
+	fault_record(FAULT_EVICT, start);
 	return victim;
 }
 
 /* palloc() and get frame. If there is no available page, evict the page
- * and return it. This always return valid address. That is, if the user pool
- * memory is full, this function evicts the frame to get the available memory
- * space.*/
+ * and return it. That is, if the user pool memory is full, this function
+ * evicts the frame to get the available memory space.  Returns NULL if
+ * no frame can be evicted either, e.g. when every frame is pinned or
+ * swap is full. */
 static struct frame *
 vm_get_frame (void) {
-	// struct frame *frame = NULL;
-	struct frame *frame = malloc(sizeof(struct frame)); // vm_do_claim_page에 넘어갈때 사라지면 안되니까 지역 변수 x, malloc으로 // malloc을 못하면 kernal 공간부족 그냥 끝
+	struct frame *frame = NULL;
+	struct thread *curr = thread_current();
 	/* TODO: Fill this function. */
+	/* 상주 페이지 상한에 닿은 프로세스는 자기 프레임부터 내보낸다 */
+	if (curr->rss_limit != 0 && curr->rss_cnt >= curr->rss_limit){
+		struct frame *victim = vm_evict_frame(curr);
+		if (victim != NULL)
+			return victim;
+	}
 	void *kva = palloc_get_page(PAL_USER);
 	/* todo : swap_out 처리 */
 	if (kva == NULL){   // palloc_get 실패하면 ram에 공간이 부족하다는 거니까 disk에서 swap_out 처리
-    	// PANIC("todo");
 		// printf("vm_get_frame: %p\n",kva);
-		struct frame *victim = vm_evict_frame();
-		frame->page = NULL;
-		return victim;
+		return vm_evict_frame(NULL);
+	}
+	frame = malloc(sizeof(struct frame)); // vm_do_claim_page에 넘어갈때 사라지면 안되니까 지역 변수 x, malloc으로
+	if (frame == NULL){
+		palloc_free_page(kva);
+		return NULL;
 	}
-	// struct frame *frame; 
     frame->kva = kva;
 	frame->page = NULL; // null로 초기화 함으로써 어떤 페이지와도 연결되지 않았음을 명확히 함
+	list_init(&frame->pages);
+	frame->ref_cnt = 0;
+	frame->pin_cnt = 0;
+	frame->spared = 0;
 
 	// list_push_back(&frame_table, &frame->frame_elem); // frame_elem으로 frame 구조체에 접근할수잇음
 	ASSERT (frame != NULL);
@@ -283,17 +383,410 @@ vm_get_frame (void) {
 	return frame;
 }
 
-/* Growing the stack. */
-static void
+/* Growing the stack.
+ * Maps every page from the current stack bottom down to ADDR, plus
+ * the process's pre-fault allowance below it, so that a large frame
+ * or a deep call chain takes one fault instead of one per page. */
+static bool
 vm_stack_growth (void *addr UNUSED) {
-	// todo: 스택 크기를 증가시키기 위해 anon page를 하나 이상 할당하여 주어진 주소(addr)가 더 이상 예외 주소(faulted address)가 되지 않도록 합니다.
-    // todo: 페이지를 할당할 때는 주소를 PGSIZE 기준으로 내림
-	vm_alloc_page(VM_ANON | VM_MARKER_0, pg_round_down(addr), 1);
+	struct thread *curr = thread_current ();
+	uint8_t *new_bottom = pg_round_down (addr);
+	uint8_t *upage;
+
+	if ((size_t) (new_bottom - (uint8_t *) curr->stack_floor) > curr->stack_prefault)
+		new_bottom -= ROUND_UP (curr->stack_prefault, PGSIZE);
+	else
+		new_bottom = curr->stack_floor;
+
+	for (upage = (uint8_t *) curr->stack_bottom - PGSIZE; upage >= new_bottom;
+			upage -= PGSIZE) {
+		/* Leave pages that something else already mapped alone. */
+		if (spt_find_page (&curr->spt, upage) != NULL)
+			continue;
+		if (!vm_alloc_page (VM_ANON | VM_STACK, upage, 1)
+				|| !vm_claim_page (upage))
+			return false;
+		curr->stack_bottom = upage;
+	}
+	return true;
+}
+
+/* Sets the current process's stack reservation to LIMIT bytes
+ * below USER_STACK and maps PREFAULT extra bytes on each stack
+ * growth.  Fails if LIMIT is too large or smaller than the stack
+ * that is already mapped. */
+bool
+vm_set_stack_limit (size_t limit, size_t prefault) {
+	struct thread *curr = thread_current ();
+
+	limit = ROUND_UP (limit, PGSIZE);
+	if (limit > STACK_LIMIT_MAX
+			|| USER_STACK - limit > (uint64_t) curr->stack_bottom)
+		return false;
+	curr->stack_floor = (void *) (USER_STACK - limit);
+	curr->stack_prefault = prefault < limit ? prefault : limit;
+	return true;
+}
+
+/* Counts PAGE in or out (DELTA) of the resident page statistics. */
+static void
+vm_stat_resident (struct page *page, int delta) {
+	enum vm_type type = page_get_type (page);
+
+	if (type == VM_ANON || type == VM_SHM)
+		vm_stat_add (anon_resident, delta);
+	else
+		vm_stat_add (file_resident, delta);
+}
+
+/* Makes PAGE one of the pages mapped to FRAME.
+ * Caller must hold frame_table_lock. */
+static void
+frame_add_page (struct frame *frame, struct page *page) {
+	list_push_back (&frame->pages, &page->frame_page_elem);
+	if (frame->ref_cnt++ == 0)
+		frame->page = page;
+	page->frame = frame;
+	page->owner->rss_cnt++;
+	vm_stat_resident (page, 1);
+}
+
+/* Unlinks PAGE from its frame and returns how many pages still
+ * use the frame.  Caller must hold frame_table_lock. */
+static int
+frame_remove_page (struct page *page) {
+	struct frame *frame = page->frame;
+
+	list_remove (&page->frame_page_elem);
+	page->frame = NULL;
+	page->owner->rss_cnt--;
+	vm_stat_resident (page, -1);
+	if (--frame->ref_cnt > 0) {
+		if (frame->page == page)
+			frame->page = list_entry (list_front (&frame->pages),
+					struct page, frame_page_elem);
+	} else
+		frame->page = NULL;
+	return frame->ref_cnt;
+}
+
+/* Drops PAGE's reference to its frame.  Once no page uses the
+ * frame, the frame leaves the frame table and its kernel page is
+ * returned to the caller, who then owns it; otherwise returns NULL.
+ * The caller takes care of PAGE's mapping. */
+void *
+vm_frame_detach (struct page *page) {
+	struct frame *frame = page->frame;
+	void *kva;
+
+	if (frame == NULL)
+		return NULL;
+	lock_acquire (&frame_table_lock);
+	if (frame_remove_page (page) > 0) {
+		lock_release (&frame_table_lock);
+		return NULL;
+	}
+	list_remove (&frame->frame_elem);
+	lock_release (&frame_table_lock);
+
+	kva = frame->kva;
+	free (frame);
+	return kva;
+}
+
+/* Drops PAGE's reference to its frame, freeing the frame once no
+ * page uses it.  The caller takes care of PAGE's mapping. */
+void
+vm_frame_release (struct page *page) {
+	palloc_free_page (vm_frame_detach (page));
+}
+
+/* Caps the current process's resident set at LIMIT bytes, or lifts
+ * the cap if LIMIT is 0, and evicts its own pages down to the new
+ * cap at once.  Once at the cap, the process makes room for a new
+ * page by evicting one of its own instead of someone else's. */
+bool
+vm_set_rss_limit (size_t limit) {
+	struct thread *curr = thread_current ();
+
+	if (limit != 0 && limit < RSS_LIMIT_MIN)
+		return false;
+	curr->rss_limit = DIV_ROUND_UP (limit, PGSIZE);
+	while (curr->rss_limit != 0 && curr->rss_cnt > curr->rss_limit) {
+		struct frame *victim = vm_evict_frame (curr);
+		if (victim == NULL)
+			break;
+		palloc_free_page (victim->kva);
+		free (victim);
+	}
+	return true;
 }
 
 /* Handle the fault on write_protected page */
+/* fork 이후 쓰기 보호된 페이지에 쓰기: 다른 프로세스와 공유 중인
+ * 익명 페이지라면 복사본을 만들고, 아니면 쓰기 권한만 되돌린다. */
 static bool
 vm_handle_wp (struct page *page UNUSED) {
+	struct frame *frame = page->frame;
+	bool shared, success;
+
+	if (!page->writable || frame == NULL)
+		return false;
+
+	lock_acquire (&frame_table_lock);
+	shared = frame->ref_cnt > 1;
+	lock_release (&frame_table_lock);
+
+	if (shared && page_get_type (page) == VM_ANON) {
+		struct frame *copy = vm_get_frame ();
+
+		if (copy == NULL)
+			return false;
+		memcpy (copy->kva, frame->kva, PGSIZE);
+		vm_frame_release (page);
+
+		lock_acquire (&frame_table_lock);
+		frame_add_page (copy, page);
+		list_push_back (&frame_table, &copy->frame_elem);
+		lock_release (&frame_table_lock);
+	}
+	/* 프레임 이동(vm_migrate_frame)과 겹치지 않도록 잠근 채 매핑한다 */
+	lock_acquire (&frame_table_lock);
+	success = pml4_set_page (thread_current ()->pml4, page->va,
+			page->frame->kva, true);
+	lock_release (&frame_table_lock);
+	return success;
+}
+
+/* Maps resident PAGE again after pml4_clear_page() had to drop the
+ * shared page table it was in.  A frame fork still shares stays
+ * read-only so that the first write copies it.  The mapping is made
+ * under frame_table_lock so that vm_migrate_frame() cannot move the
+ * frame in between. */
+static bool
+vm_remap_page (struct page *page) {
+	bool writable, success;
+
+	lock_acquire (&frame_table_lock);
+	writable = page->writable && (page->frame->ref_cnt == 1
+			|| page_get_type (page) == VM_SHM);
+	success = pml4_set_page (thread_current ()->pml4, page->va,
+			page->frame->kva, writable);
+	lock_release (&frame_table_lock);
+	return success;
+}
+
+/* Returns the class of a not-present fault on PAGE. */
+static enum fault_class
+fault_classify (struct page *page) {
+	switch (VM_TYPE (page->operations->type)) {
+		case VM_UNINIT:
+			return page->uninit.init != NULL ? FAULT_FILE : FAULT_ANON;
+		case VM_ANON:
+			return page->anon.sec_no != -1 ? FAULT_SWAP_IN : FAULT_ANON;
+		case VM_SHM:
+			return shm_is_swapped (page) ? FAULT_SWAP_IN : FAULT_ANON;
+		default:
+			return FAULT_FILE_REREAD;
+	}
+}
+
+/* Fault latencies of all processes. */
+static struct fault_hist fault_hist;
+
+/* Records a CLASS fault that started at TSC value START, in the
+ * system-wide histograms and in the current process's, which
+ * process_exec() and fork allocate. */
+static void
+fault_record (enum fault_class class, uint64_t start) {
+	struct thread *curr = thread_current ();
+	uint64_t cycles = rdtsc () - start;
+	int bucket = cycles != 0 ? 63 - __builtin_clzll (cycles) : 0;
+	enum intr_level old_level;
+
+	if (bucket >= FAULT_HIST_BUCKETS)
+		bucket = FAULT_HIST_BUCKETS - 1;
+
+	old_level = intr_disable ();
+	fault_hist.count[class][bucket]++;
+	if (curr->fault_hist != NULL)
+		curr->fault_hist->count[class][bucket]++;
+	intr_set_level (old_level);
+}
+
+/* Copies the fault latency histograms to HIST: those of every
+ * process if ALL, otherwise the current process's. */
+void
+vm_get_fault_hist (struct fault_hist *hist, bool all) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level = intr_disable ();
+
+	if (all)
+		memcpy (hist, &fault_hist, sizeof *hist);
+	else if (curr->fault_hist != NULL)
+		memcpy (hist, curr->fault_hist, sizeof *hist);
+	else
+		memset (hist, 0, sizeof *hist);
+	intr_set_level (old_level);
+}
+
+/* Prints the system-wide fault latency histograms, one line per
+ * fault class that saw any faults. */
+void
+vm_print_stats (void) {
+	static const char *names[FAULT_CLASS_CNT] = {
+		"stack", "anon", "file", "swap-in", "file-reread", "cow", "evict",
+	};
+	int class, bucket, last;
+
+	for (class = 0; class < FAULT_CLASS_CNT; class++) {
+		for (last = FAULT_HIST_BUCKETS - 1; last >= 0; last--)
+			if (fault_hist.count[class][last] != 0)
+				break;
+		if (last < 0)
+			continue;
+		printf ("Fault latency (%s, log2 cycles):", names[class]);
+		for (bucket = 0; bucket <= last; bucket++)
+			if (fault_hist.count[class][bucket] != 0)
+				printf (" %d:%llu", bucket, fault_hist.count[class][bucket]);
+		printf ("\n");
+	}
+}
+
+/* Takes a consistent snapshot of the VM counters into STAT. */
+void
+vm_get_stat (struct vmstat *stat) {
+	enum intr_level old_level = intr_disable ();
+	size_t used, free_cnt;
+
+	*stat = vm_stat;
+	palloc_user_usage (&used, &free_cnt);
+	stat->user_frames_used = used;
+	stat->user_frames_free = free_cnt;
+	intr_set_level (old_level);
+}
+
+/* Returns the memory map region type of PAGE, from its page type. */
+static enum region_type
+page_region_type (struct page *page) {
+	switch (page_get_type (page)) {
+		case VM_FILE:
+			return REGION_FILE;
+		case VM_SHM:
+			return REGION_SHM;
+		default:
+			if (VM_TYPE (page->operations->type) == VM_UNINIT)
+				return page->uninit.type & VM_STACK ? REGION_STACK : REGION_ANON;
+			return page->anon.stack ? REGION_STACK : REGION_ANON;
+	}
+}
+
+/* Returns the file PAGE maps, so that adjacent mappings of two files
+ * show up as two regions, or NULL for anonymous pages. */
+static struct file *
+region_file (struct page *page) {
+	switch (VM_TYPE (page->operations->type)) {
+		case VM_UNINIT:
+			if (VM_TYPE (page->uninit.type) != VM_FILE)
+				return NULL;
+			return ((struct lazy_load_info *) page->uninit.aux)->file;
+		case VM_FILE:
+			return page->file.file;
+		default:
+			return NULL;
+	}
+}
+
+/* Orders pages by virtual address, for qsort(). */
+static int
+page_va_compare (const void *a_, const void *b_) {
+	const struct page *a = *(struct page * const *) a_;
+	const struct page *b = *(struct page * const *) b_;
+
+	return a->va < b->va ? -1 : a->va > b->va;
+}
+
+/* Collects the pages of SPT in one pass over its hash and returns
+ * them in address order as a malloc()'d array, storing the number
+ * of pages in *CNT.  Returns a null pointer if SPT is empty or
+ * memory is short; *CNT tells the two apart. */
+struct page **
+spt_sorted_pages (struct supplemental_page_table *spt, size_t *cnt) {
+	struct hash_iterator i;
+	struct page **pages;
+	size_t idx = 0;
+
+	*cnt = hash_size (&spt->spt_hash);
+	if (*cnt == 0)
+		return NULL;
+	pages = malloc (*cnt * sizeof *pages);
+	if (pages == NULL)
+		return NULL;
+	hash_first (&i, &spt->spt_hash);
+	while (hash_next (&i))
+		pages[idx++] = hash_entry (hash_cur (&i), struct page, hash_elem);
+	qsort (pages, *cnt, sizeof *pages, page_va_compare);
+	return pages;
+}
+
+/* Summarizes the current process's memory map into at most MAX
+ * REGIONS, in address order.  Takes one pass over the SPT and reads
+ * the dirty and accessed bits of resident pages from the page
+ * table.  Returns the number of regions in the map, which may be
+ * more than MAX, or -1 if out of memory.  The counts are a snapshot:
+ * eviction may change them while the walk runs. */
+int
+vm_get_regions (struct mem_region *regions, int max) {
+	struct thread *curr = thread_current ();
+	struct mem_region region;
+	struct file *region_backing = NULL;
+	struct page **pages;
+	size_t page_cnt, idx;
+	int region_cnt = 0;
+
+	pages = spt_sorted_pages (&curr->spt, &page_cnt);
+	if (pages == NULL)
+		return page_cnt == 0 ? 0 : -1;
+
+	for (idx = 0; idx < page_cnt; idx++) {
+		struct page *page = pages[idx];
+		enum region_type type = page_region_type (page);
+		struct file *backing = region_file (page);
+
+		/* Start a new region where the run of like pages breaks. */
+		if (idx == 0 || (uintptr_t) page->va != region.end
+				|| type != region.type || page->writable != region.writable
+				|| backing != region_backing) {
+			if (idx != 0 && region_cnt++ < max)
+				regions[region_cnt - 1] = region;
+			memset (&region, 0, sizeof region);
+			region.start = (uintptr_t) page->va;
+			region.type = type;
+			region.writable = page->writable;
+			region_backing = backing;
+		}
+		region.end = (uintptr_t) page->va + PGSIZE;
+
+		if (VM_TYPE (page->operations->type) == VM_UNINIT)
+			region.untouched++;
+		else if ((VM_TYPE (page->operations->type) == VM_ANON
+					&& page->anon.sec_no != -1)
+				|| (VM_TYPE (page->operations->type) == VM_SHM
+					&& shm_is_swapped (page)))
+			region.swapped++;
+		if (page->frame != NULL) {
+			region.resident++;
+			if (pml4_is_dirty (curr->pml4, page->va))
+				region.dirty++;
+			if (pml4_is_accessed (curr->pml4, page->va))
+				region.accessed++;
+		}
+	}
+	if (region_cnt++ < max)
+		regions[region_cnt - 1] = region;
+
+	free (pages);
+	return region_cnt;
 }
 
 /* Return true on success */
@@ -310,6 +803,10 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 	struct page *page = NULL;
 	/* TODO: Validate the fault */
 	/* TODO: Your code goes here */
+	uint64_t start = rdtsc();
+	enum fault_class class;
+	bool grown = false;
+
 	if (is_kernel_vaddr(addr) && addr == NULL) {
 		return false;
 	}
@@ -320,22 +817,156 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 		rsp = thread_current()->rsp;
 		/* todo : stack growth */
 		// 스택 확장으로 처리할 수 있는 폴트인 경우, vm_stack_growth를 호출한다.
-		// 1<<20 = 1MB
-		if (USER_STACK - (1 << 20) <= rsp - 8 && rsp - 8 <= addr && addr <= USER_STACK)
-			vm_stack_growth(addr);
+		if (thread_current ()->stack_floor <= rsp - 8 && rsp - 8 <= addr
+				&& addr < thread_current ()->stack_bottom)
+			grown = vm_stack_growth(addr);
 
 		page = spt_find_page(spt, addr);
 		if (page == NULL)
 			return false;
-	
+		if (page->frame != NULL) // 스택 확장이 이미 올려 둔 페이지
+		{
+			if (grown)
+				fault_record(FAULT_STACK, start);
+			// 공유 페이지 테이블째로 매핑이 떨어져 나간 경우 다시 매핑한다
+			else if (pml4_get_page(thread_current()->pml4, page->va) == NULL)
+				return vm_remap_page(page);
+			return true;
+		}
 
 		if (write == 1 && page->writable == 0) // write 불가능한 페이지에 write 요청한 경우
             return false;
-        return vm_do_claim_page(page);
+		class = fault_classify(page);
+		if (!vm_do_claim_page(page))
+			return false;
+		if (class == FAULT_ANON)
+			vm_stat_add(minor_faults, 1);
+		else
+			vm_stat_add(major_faults, 1);
+		fault_record(class, start);
+		return true;
+	}
+	if (write) // read only 매핑에 write: fork로 공유된 페이지 테이블이나 프레임
+	{
+		page = spt_find_page(spt, addr);
+		if (page == NULL)
+			return false;
+		if (!pml4_unshare(thread_current()->pml4, page->va)
+				|| !vm_handle_wp(page))
+			return false;
+		vm_stat_add(minor_faults, 1);
+		fault_record(FAULT_COW, start);
+		return true;
 	}
     return false;
 }
 
+/* Makes sure that the kernel can reach PAGE, whose frame the caller
+ * has just pinned, without a fault: pml4_unshare() may have taken
+ * write access away from its whole table, and pml4_detach() may
+ * have dropped the mapping.  Caller must hold frame_table_lock. */
+static bool
+vm_pin_map (struct page *page, bool write) {
+	uint64_t *pml4 = thread_current ()->pml4;
+	struct frame *frame = page->frame;
+
+	if (write ? pml4_make_writable (pml4, page->va)
+			: pml4_get_page (pml4, page->va) != NULL)
+		return true;
+	return pml4_set_page (pml4, page->va, frame->kva, write
+			|| (page->writable && (frame->ref_cnt == 1
+					|| page_get_type (page) == VM_SHM)));
+}
+
+/* Pins the frame of PAGE, faulting it in first if needed, and maps
+ * it for the access the caller will make.  With WRITE, a frame
+ * still shared with a fork sibling is copied now rather than in the
+ * middle of the caller's I/O. */
+static bool
+vm_pin_page (struct page *page, bool write) {
+	struct frame *frame;
+
+	for (;;) {
+		lock_acquire (&frame_table_lock);
+		frame = page->frame;
+		if (frame != NULL && !(write && frame->ref_cnt > 1
+					&& page_get_type (page) == VM_ANON)) {
+			bool mapped;
+
+			frame->pin_cnt++;
+			mapped = vm_pin_map (page, write);
+			if (!mapped)
+				frame->pin_cnt--;
+			lock_release (&frame_table_lock);
+			return mapped;
+		}
+		lock_release (&frame_table_lock);
+
+		if (frame == NULL) {
+			if (!vm_do_claim_page (page))
+				return false;
+		} else if (!pml4_unshare (thread_current ()->pml4, page->va)
+				|| !vm_handle_wp (page))
+			return false;
+	}
+}
+
+/* Faults in every page of the user buffer [UADDR, UADDR + SIZE) in
+ * one pass and pins their frames, so that I/O on the buffer neither
+ * faults nor loses a page to eviction while it holds filesys_lock.
+ * WRITE is true if the kernel will write to the buffer.  Returns
+ * false, with nothing left pinned, if part of the buffer is not
+ * valid user memory. */
+bool
+vm_pin_range (const void *uaddr, size_t size, bool write) {
+	struct thread *curr = thread_current ();
+	uint8_t *start = pg_round_down (uaddr);
+	uint8_t *upage;
+
+	if (size == 0)
+		return true;
+	if ((uint8_t *) uaddr + size < (uint8_t *) uaddr
+			|| !is_user_vaddr ((uint8_t *) uaddr + size - 1))
+		return false;
+
+	for (upage = start; upage < (uint8_t *) uaddr + size; upage += PGSIZE) {
+		struct page *page = spt_find_page (&curr->spt, upage);
+
+		/* A buffer just below the stack pointer grows the stack, as a
+		 * fault there would. */
+		if (page == NULL && curr->stack_floor <= curr->rsp - 8
+				&& curr->rsp - 8 <= (void *) upage
+				&& (void *) upage < curr->stack_bottom) {
+			vm_stack_growth (upage);
+			page = spt_find_page (&curr->spt, upage);
+		}
+		if (page == NULL || (write && !page->writable)
+				|| !vm_pin_page (page, write)) {
+			vm_unpin_range (start, upage - start);
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Releases the pins vm_pin_range() took on [UADDR, UADDR + SIZE). */
+void
+vm_unpin_range (const void *uaddr, size_t size) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *upage;
+
+	if (size == 0)
+		return;
+	lock_acquire (&frame_table_lock);
+	for (upage = pg_round_down (uaddr); upage < (uint8_t *) uaddr + size;
+			upage += PGSIZE) {
+		struct page *page = spt_find_page (spt, upage);
+		if (page != NULL && page->frame != NULL && page->frame->pin_cnt > 0)
+			page->frame->pin_cnt--;
+	}
+	lock_release (&frame_table_lock);
+}
+
 /* Free the page.
  * DO NOT MODIFY THIS FUNCTION. */
 void
@@ -356,22 +987,120 @@ vm_claim_page (void *va UNUSED) {
 	return vm_do_claim_page (page);
 }
 
+/* Claims shared memory PAGE.  If another mapping already has the
+ * object page in a frame, PAGE joins that frame and FRAME is freed;
+ * otherwise the object page is brought into FRAME.  shm_lock keeps
+ * eviction from clearing the mappings until the PTE is in place. */
+static bool
+vm_do_claim_shm (struct page *page, struct frame *frame) {
+	struct frame *shared;
+	bool success = true;
+
+	shm_lock_acquire ();
+	shared = shm_get_frame (page);
+	lock_acquire (&frame_table_lock);
+	if (shared != NULL)
+		frame_add_page (shared, page);
+	else {
+		frame_add_page (frame, page);
+		frame->pin_cnt++;
+		list_push_back (&frame_table, &frame->frame_elem);
+	}
+	lock_release (&frame_table_lock);
+
+	if (shared != NULL) {
+		palloc_free_page (frame->kva);
+		free (frame);
+		frame = shared;
+	} else {
+		success = swap_in (page, frame->kva);
+		lock_acquire (&frame_table_lock);
+		frame->pin_cnt--;
+		lock_release (&frame_table_lock);
+	}
+	success = success && pml4_set_page (thread_current ()->pml4, page->va,
+			frame->kva, page->writable);
+	shm_lock_release ();
+	return success;
+}
+
 /* Claim the PAGE and set up the mmu. */
 static bool
 vm_do_claim_page (struct page *page) {
 	struct frame *frame = vm_get_frame ();
 
-	/* Set links */
-	frame->page = page;
-	page->frame = frame;
+	if (frame == NULL)
+		return false;
+	if (VM_TYPE (page->operations->type) == VM_SHM)
+		return vm_do_claim_shm (page, frame);
 
+	/* Set links */
+	/* 내용을 채우는 동안에는 내보내거나 옮기지 못하도록 고정한다 */
 	lock_acquire(&frame_table_lock);
+	frame_add_page(frame, page);
+	frame->pin_cnt++;
 	list_push_back(&frame_table, &frame->frame_elem);
 	lock_release(&frame_table_lock);
 
 	/* TODO: Insert page table entry to map page's VA to frame's PA. */
 	pml4_set_page(thread_current()->pml4, page->va, frame->kva, page->writable);
-	return swap_in (page, frame->kva);
+	bool success = swap_in (page, frame->kva);
+
+	lock_acquire(&frame_table_lock);
+	frame->pin_cnt--;
+	lock_release(&frame_table_lock);
+	return success;
+}
+
+/* Moves the user page held in the frame at KVA to a new frame, for
+ * palloc's compaction, and leaves KVA allocated to the caller.
+ * Only anonymous and file frames that one page uses and that are not
+ * pinned move; shared memory frames are also reachable through
+ * shm.c and stay put. */
+static bool
+vm_migrate_frame (void *kva) {
+	struct frame *frame = NULL;
+	struct list_elem *e;
+	struct page *page;
+	enum vm_type type;
+	void *new_kva;
+	enum intr_level old_level;
+
+	lock_acquire (&frame_table_lock);
+	for (e = list_begin (&frame_table); e != list_end (&frame_table);
+			e = list_next (e))
+		if (list_entry (e, struct frame, frame_elem)->kva == kva) {
+			frame = list_entry (e, struct frame, frame_elem);
+			break;
+		}
+	if (frame == NULL || frame->ref_cnt != 1 || frame->pin_cnt > 0) {
+		lock_release (&frame_table_lock);
+		return false;
+	}
+	page = frame->page;
+	type = page_get_type (page);
+	if (type != VM_ANON && type != VM_FILE) {
+		lock_release (&frame_table_lock);
+		return false;
+	}
+	new_kva = palloc_get_page (PAL_USER);
+	if (new_kva == NULL
+			|| !pml4_unshare (page->owner->pml4, page->va)) {
+		lock_release (&frame_table_lock);
+		palloc_free_page (new_kva);
+		return false;
+	}
+
+	/* The owner must not write to the old frame between the copy and
+	 * the switch of its mapping. */
+	old_level = intr_disable ();
+	memcpy (new_kva, kva, PGSIZE);
+	pml4_move_page (page->owner->pml4, page->va, new_kva);
+	frame->kva = new_kva;
+	intr_set_level (old_level);
+
+	lock_release (&frame_table_lock);
+	return true;
 }
 
 /* Initialize new supplemental page table */
@@ -403,16 +1132,33 @@ supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
        		 	{ // uninit src_page 생성 & 초기화
             	vm_initializer *init = src_page->uninit.init;
             	void *aux = src_page->uninit.aux;
-            	vm_alloc_page_with_initializer(VM_ANON, upage, writable, init, aux);
+            	vm_alloc_page_with_initializer(VM_ANON | (src_page->uninit.type & VM_STACK),
+						upage, writable, init, aux);
             	continue;
         		}
 
+				/* 공유 메모리는 자식도 같은 객체를 매핑한다 */
+				if (type == VM_SHM)
+				{
+					struct page *shm_page = shm_page_dup(src_page);
+					if (shm_page == NULL)
+						return false;
+					shm_lock_acquire();
+					lock_acquire(&frame_table_lock);
+					if (src_page->frame != NULL)
+						frame_add_page(src_page->frame, shm_page);
+					lock_release(&frame_table_lock);
+					shm_lock_release();
+					continue;
+				}
+
 				/* type이 file이면 */
         		if (type == VM_FILE)
     			{
 				struct lazy_load_info *file_aux = malloc(sizeof(struct lazy_load_info));
 
 				file_aux->file = src_page->file.file;
+				file_aux->upage = upage;
 				file_aux->offset = src_page->file.offset;
 				file_aux->read_bytes = src_page->file.read_bytes;
 				file_aux->zero_bytes = src_page->file.zero_bytes;
@@ -425,23 +1171,30 @@ supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
 				struct page *file_page = spt_find_page(dst, upage);
 
 				file_backed_initializer(file_page, type, NULL);
-				file_page->frame = src_page->frame;
-				pml4_set_page(thread_current()->pml4, file_page->va, src_page->frame->kva, src_page->writable);
+				/* 프레임은 공유하고, 매핑은 pml4_share_user()가 페이지 테이블째로 넘겨준다. */
+				lock_acquire(&frame_table_lock);
+				if (src_page->frame != NULL)
+					frame_add_page(src_page->frame, file_page);
+				lock_release(&frame_table_lock);
 				continue;
         		}
 
-				/* type이 uninit이 아니면*/
+				/* type이 uninit이 아니면: 프레임을 공유하고 첫 쓰기에서 복사한다 */
 				if (!vm_alloc_page(type, upage, writable)){
 				// printf("[supplemental_page_table_copy] type : anon\n");
 					return false;}
-				if (!vm_claim_page(upage)){
-				// printf("[supplemental_page_table_copy] type : anon\n");	
-					return false;}
-				// hash_insert(&dst->spt_hash, &src_page->hash_elem);
 				struct page *dst_page = spt_find_page(dst,upage);
-				// printf("[supplemental_page_table_copy] page : %p\n",dst_page->frame->kva);
-				memcpy(dst_page->frame->kva, src_page->frame->kva, PGSIZE);
-				// printf("[supplemental_page_table_copy] dst_page : %p\n",memcpy(dst_page->frame->kva, src_page->frame->kva, PGSIZE));
+				anon_initializer(dst_page, src_page->anon.stack ? type | VM_STACK : type, NULL);
+
+				lock_acquire(&frame_table_lock);
+				struct frame *frame = src_page->frame;
+				if (frame != NULL)
+					frame_add_page(frame, dst_page);
+				lock_release(&frame_table_lock);
+
+				/* swap out된 페이지는 swap slot을 복사한다 */
+				if (frame == NULL && !anon_swap_dup(dst_page, src_page))
+					return false;
 			}
 			return true;
 }